@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+#include <memory>
+#include <random>
+#include "localsearchsolver/best_first_local_search.hpp"
+#include "localsearchsolver/genetic_local_search.hpp"
+#include "InstanciaMIS.hpp"
+#include "EsquemaMIS.hpp"
+#include "IslasMIS.hpp"
+
+// Motores de la libreria que se pueden usar sobre EsquemaMIS. El ILS corre
+// por islas (IslasMIS.hpp); best first y genetico son multihilo por si
+// mismos y reciben los hilos de la componente.
+
+enum class AlgoritmoMIS {
+    IteratedLocalSearch,
+    BestFirstLocalSearch,
+    GeneticLocalSearch,
+};
+
+inline AlgoritmoMIS leer_algoritmo(const std::string& nombre) {
+    if (nombre == "iterated-local-search") return AlgoritmoMIS::IteratedLocalSearch;
+    if (nombre == "best-first-local-search") return AlgoritmoMIS::BestFirstLocalSearch;
+    if (nombre == "genetic-local-search") return AlgoritmoMIS::GeneticLocalSearch;
+    throw std::invalid_argument("Algoritmo desconocido: " + nombre);
+}
+
+// Corre best first (p.islas hilos sobre el mismo pool de nodos) o el genetico
+// (p.islas hilos sobre la misma poblacion) y devuelve la mejor solucion.
+inline InstanciaMIS::Solucion motor_multihilo(const Graph& g, const ParametrosIslas& p,
+                                              AlgoritmoMIS algoritmo, double& tiempo_al_mejor) {
+    using localsearchsolver::EsquemaMIS;
+    auto intercambio = std::make_shared<localsearchsolver::IntercambioMIS>();
+    EsquemaMIS esquema(g, intercambio);
+    esquema.alpha = p.alpha;
+    esquema.fuerza_perturbacion = p.fuerza_perturbacion;
+
+    // Los hilos trabajan con copias del esquema, asi que la mejora se publica
+    // directo en el intercambio (seguro entre hilos).
+    auto configurar = [&](localsearchsolver::Parameters<EsquemaMIS>& params) {
+        params.timer.set_time_limit(std::max(p.tiempo_limite, 0.0));
+        params.seed = p.semilla;
+        params.verbosity_level = p.verbosity_level;
+        params.new_solution_callback = [intercambio](const localsearchsolver::Output<EsquemaMIS>& output) {
+            intercambio->publicar(output.solution_pool.best());
+        };
+    };
+
+    InstanciaMIS::Solucion mejor = esquema.empty_solution();
+    bool encontrada = false;
+    if (algoritmo == AlgoritmoMIS::BestFirstLocalSearch) {
+        localsearchsolver::BestFirstLocalSearchParameters<EsquemaMIS> params;
+        configurar(params);
+        params.number_of_threads_1 = 1;
+        params.number_of_threads_2 = std::max(1u, p.islas);
+        auto output = localsearchsolver::best_first_local_search(esquema, params);
+        encontrada = output.solution_pool.size() > 0;
+        mejor = output.solution_pool.best();
+    } else {
+        localsearchsolver::GeneticLocalSearchParameters<EsquemaMIS> params;
+        configurar(params);
+        params.number_of_threads = std::max(1u, p.islas);
+        params.maximum_number_of_iterations = p.max_iteraciones;
+        auto output = localsearchsolver::genetic_local_search(esquema, params);
+        encontrada = output.solution_pool.size() > 0;
+        mejor = output.solution_pool.best();
+    }
+    if (!encontrada) {
+        // Sin tiempo: al menos una solucion GRASP + busqueda local.
+        std::mt19937_64 generator(p.semilla);
+        mejor = esquema.initial_solution(0, generator);
+        esquema.local_search(mejor, generator);
+        intercambio->publicar(mejor);
+    }
+    tiempo_al_mejor = intercambio->tiempo_al_mejor();
+    return mejor;
+}
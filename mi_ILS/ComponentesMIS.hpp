@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "localsearchsolver/iterated_local_search.hpp"
+#include "InstanciaMIS.hpp"
+#include "EsquemaMIS.hpp"
+#include "IslasMIS.hpp"
+#include "GrafoDenso.hpp"
+#include "AlgoritmosMIS.hpp"
+
+// Descomposicion en componentes conexas: el MIS del grafo es la union de los
+// MIS de sus componentes. Las componentes chicas se resuelven de forma exacta
+// y las grandes con un ILS por islas cada una, repartidas entre un pool de
+// hilos. Con el ILS las componentes densas usan GrafoDenso y EsquemaMISDenso.
+
+struct Componente {
+    // vertices[i] es el id, en el grafo completo, del vertice i del subgrafo.
+    std::vector<int> vertices;
+    std::unique_ptr<Graph> grafo;
+};
+
+// Componentes conexas de g (BFS), ordenadas de mayor a menor tamanio.
+inline std::vector<Componente> componentes_conexas(const Graph& g) {
+    const int n = g.n();
+    std::vector<int> id_local(n, -1);
+    std::vector<Componente> componentes;
+    std::vector<std::pair<int, int>> aristas;
+    for (int r = 0; r < n; ++r) {
+        if (id_local[r] != -1) continue;
+        Componente c;
+        id_local[r] = 0;
+        c.vertices.push_back(r);
+        for (std::size_t i = 0; i < c.vertices.size(); ++i) {
+            for (int u : g.vecinos(c.vertices[i])) {
+                if (id_local[u] != -1) continue;
+                id_local[u] = (int)c.vertices.size();
+                c.vertices.push_back(u);
+            }
+        }
+        aristas.clear();
+        for (int v : c.vertices)
+            for (int u : g.vecinos(v))
+                if (u > v) aristas.push_back({id_local[v], id_local[u]});
+        c.grafo.reset(new Graph((int)c.vertices.size(), aristas));
+        componentes.push_back(std::move(c));
+    }
+    std::stable_sort(componentes.begin(), componentes.end(),
+                     [](const Componente& a, const Componente& b) {
+                         return a.vertices.size() > b.vertices.size();
+                     });
+    return componentes;
+}
+
+// MIS exacto para grafos de hasta 64 vertices (conjuntos como mascaras de
+// bits). Ramifica sobre el vertice v de menor grado: algun vertice de N[v]
+// esta en un MIS, y si grado(v) <= 1 basta con tomar v.
+class MISExacto {
+public:
+    explicit MISExacto(const Graph& g) : n_(g.n()), cerrada_(g.n()) {
+        for (int v = 0; v < n_; ++v) {
+            cerrada_[v] = (std::uint64_t)1 << v;
+            for (int u : g.vecinos(v)) cerrada_[v] |= (std::uint64_t)1 << u;
+        }
+    }
+
+    // Devuelve el conjunto optimo como mascara.
+    std::uint64_t resolver() {
+        mejor_ = 0;
+        mejor_tamanio_ = 0;
+        std::uint64_t todos = (n_ == 64) ? ~(std::uint64_t)0 : (((std::uint64_t)1 << n_) - 1);
+        ramificar(todos, 0);
+        return mejor_;
+    }
+
+private:
+    int n_;
+    std::vector<std::uint64_t> cerrada_;
+    std::uint64_t mejor_ = 0;
+    int mejor_tamanio_ = 0;
+
+    void ramificar(std::uint64_t restantes, std::uint64_t actual) {
+        int tamanio = __builtin_popcountll(actual);
+        if (restantes == 0) {
+            if (tamanio > mejor_tamanio_) {
+                mejor_tamanio_ = tamanio;
+                mejor_ = actual;
+            }
+            return;
+        }
+        if (tamanio + __builtin_popcountll(restantes) <= mejor_tamanio_) return;
+
+        int v = -1, grado_v = 65;
+        for (std::uint64_t r = restantes; r != 0; r &= r - 1) {
+            int x = __builtin_ctzll(r);
+            int d = __builtin_popcountll(cerrada_[x] & restantes) - 1;
+            if (d < grado_v) {
+                v = x;
+                grado_v = d;
+            }
+        }
+        if (grado_v <= 1) {
+            ramificar(restantes & ~cerrada_[v], actual | ((std::uint64_t)1 << v));
+            return;
+        }
+        for (std::uint64_t r = cerrada_[v] & restantes; r != 0; r &= r - 1) {
+            int u = __builtin_ctzll(r);
+            ramificar(restantes & ~cerrada_[u], actual | ((std::uint64_t)1 << u));
+        }
+    }
+};
+
+struct ParametrosComponentes {
+    double tiempo_limite = 1.0;
+    localsearchsolver::Counter max_iteraciones = -1;
+    localsearchsolver::Counter min_perturbaciones = 1;
+    double alpha = 0.3;
+    int fuerza_perturbacion = 2;
+    AlgoritmoMIS algoritmo = AlgoritmoMIS::IteratedLocalSearch;
+    // Componentes con a lo mas este numero de vertices (<= 64) se resuelven
+    // de forma exacta.
+    int tamanio_exacto = 32;
+    // Hilos en total: si hay menos componentes grandes que hilos, los que
+    // sobran se reparten como islas de cada componente.
+    unsigned hilos = 1;
+    std::uint64_t semilla = 0;
+    int verbosity_level = 1;
+};
+
+struct ResultadoComponentes {
+    InstanciaMIS::Solucion solucion;
+    // Segundos desde el inicio de la resolucion hasta que la ultima
+    // componente encontro su mejor solucion.
+    double tiempo_al_mejor = 0.0;
+    int componentes = 0;
+    int componentes_exactas = 0;
+    // Componentes que empezaron sin tiempo propio y corrieron con el piso.
+    int componentes_con_piso = 0;
+};
+
+// Resuelve cada componente de g por separado y une las soluciones.
+//
+// Las componentes grandes se atienden de mayor a menor por un pool de hilos.
+// Al empezar, cada una recibe una parte del tiempo que le queda a la
+// resolucion proporcional a su tamanio entre las que faltan empezar,
+// restante * hilos * n_c / n_pendientes (a lo mas restante); asi el tiempo
+// que dejan las que terminan antes pasa a las siguientes. Si las primeras
+// agotaron el limite, las siguientes corren con un piso de
+// fraccion_piso * tiempo_limite * n_c / n_grandes y se cuentan en
+// componentes_con_piso.
+inline ResultadoComponentes resolver_por_componentes(const Graph& g, const ParametrosComponentes& p) {
+    using reloj = std::chrono::high_resolution_clock;
+    const auto inicio = reloj::now();
+
+    ResultadoComponentes resultado;
+    InstanciaMIS instancia(g);
+    resultado.solucion.inicializar(g.n());
+
+    std::vector<Componente> componentes = componentes_conexas(g);
+    resultado.componentes = (int)componentes.size();
+    int tamanio_exacto = std::min(p.tamanio_exacto, 64);
+
+    std::vector<const Componente*> grandes;
+    long long n_grandes = 0;
+    for (const Componente& c : componentes) {
+        if ((int)c.vertices.size() > tamanio_exacto) {
+            grandes.push_back(&c);
+            n_grandes += (long long)c.vertices.size();
+            continue;
+        }
+        resultado.componentes_exactas++;
+        std::uint64_t mascara = MISExacto(*c.grafo).resolver();
+        for (; mascara != 0; mascara &= mascara - 1)
+            instancia.agregar(resultado.solucion, c.vertices[__builtin_ctzll(mascara)]);
+    }
+    if (grandes.empty()) return resultado;
+
+    unsigned hilos = std::max(1u, std::min(p.hilos, (unsigned)grandes.size()));
+    unsigned islas = std::max(1u, p.hilos / hilos);
+    const double fraccion_piso = 0.1;
+    std::atomic<std::size_t> siguiente(0);
+    std::atomic<long long> n_pendientes(n_grandes);
+    std::atomic<int> con_piso(0);
+    std::mutex mutex;
+
+    auto trabajador = [&]() {
+        for (;;) {
+            std::size_t i = siguiente.fetch_add(1);
+            if (i >= grandes.size()) return;
+            const Componente& c = *grandes[i];
+
+            auto comienzo = reloj::now();
+            double transcurrido = std::chrono::duration<double>(comienzo - inicio).count();
+            double n_c = (double)c.vertices.size();
+            long long pendientes = n_pendientes.fetch_sub((long long)c.vertices.size());
+            double restante = p.tiempo_limite - transcurrido;
+            double tiempo = std::min(restante, restante * hilos * n_c / pendientes);
+            double piso = fraccion_piso * p.tiempo_limite * n_c / n_grandes;
+            if (tiempo < piso) {
+                tiempo = piso;
+                con_piso++;
+            }
+
+            ParametrosIslas params;
+            params.tiempo_limite = tiempo;
+            params.max_iteraciones = p.max_iteraciones;
+            params.min_perturbaciones = p.min_perturbaciones;
+            params.alpha = p.alpha;
+            params.fuerza_perturbacion = p.fuerza_perturbacion;
+            params.islas = islas;
+            params.semilla = p.semilla + i * islas;
+            // Con varias componentes en paralelo las salidas se mezclarian.
+            params.verbosity_level = (grandes.size() == 1) ? p.verbosity_level : 0;
+
+            double tiempo_al_mejor = 0.0;
+            std::vector<int> mejor;
+            if (p.algoritmo != AlgoritmoMIS::IteratedLocalSearch) {
+                auto s = motor_multihilo(*c.grafo, params, p.algoritmo, tiempo_al_mejor);
+                mejor.assign(s.vertices.begin(), s.vertices.end());
+            } else if (conviene_denso(*c.grafo)) {
+                GrafoDenso denso(*c.grafo);
+                auto s = ils_por_islas<localsearchsolver::EsquemaMISDenso>(denso, params, tiempo_al_mejor);
+                mejor.assign(s.vertices.begin(), s.vertices.end());
+            } else {
+                auto s = ils_por_islas<localsearchsolver::EsquemaMIS>(*c.grafo, params, tiempo_al_mejor);
+                mejor.assign(s.vertices.begin(), s.vertices.end());
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int v : mejor)
+                instancia.agregar(resultado.solucion, c.vertices[v]);
+            resultado.tiempo_al_mejor = std::max(
+                    resultado.tiempo_al_mejor, transcurrido + tiempo_al_mejor);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < hilos; ++t)
+        threads.emplace_back(trabajador);
+    trabajador();
+    for (auto& th : threads) th.join();
+    resultado.componentes_con_piso = con_piso;
+    return resultado;
+}
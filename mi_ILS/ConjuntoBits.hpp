@@ -0,0 +1,270 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <random>
+
+// Conjunto de vertices empaquetado en palabras de 64 bits (bit v de la
+// palabra v / 64), con kernels sobre arreglos de palabras: conteo de bits,
+// distancia de Hamming, interseccion y resta (AND-NOT). Con AVX2 se procesan
+// 4 palabras por instruccion; si no, una palabra por vez con popcount.
+//
+// En x86 con GCC o Clang los kernels AVX2 se compilan siempre (atributo
+// target) y se eligen en tiempo de ejecucion segun la CPU, asi un binario
+// compilado sin -march=native corre en cualquier maquina. Si el compilador
+// ya habilita AVX2 (-mavx2, -march=native) no hay chequeo.
+
+#if defined(__AVX2__)
+#define MIS_USAR_AVX2 1
+#define MIS_AVX2_FIJO 1
+#elif (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MIS_USAR_AVX2 1
+#endif
+
+#ifdef MIS_USAR_AVX2
+#include <immintrin.h>
+#define MIS_OBJETIVO_AVX2 __attribute__((target("avx2")))
+
+// true si los kernels AVX2 pueden usarse en esta CPU (se consulta una vez).
+inline bool cpu_con_avx2() {
+#ifdef MIS_AVX2_FIJO
+    return true;
+#else
+    static const bool soporta = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return soporta;
+#endif
+}
+
+// Popcount por byte con la tabla de nibbles de Mula (pshufb).
+MIS_OBJETIVO_AVX2 inline __m256i contar_bits_bytes(__m256i v) {
+    const __m256i tabla = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i bajo = _mm256_and_si256(v, nibble);
+    __m256i alto = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(tabla, bajo), _mm256_shuffle_epi8(tabla, alto));
+}
+
+MIS_OBJETIVO_AVX2 inline std::uint64_t sumar_lanes(__m256i acumulado) {
+    return (std::uint64_t)_mm256_extract_epi64(acumulado, 0) + (std::uint64_t)_mm256_extract_epi64(acumulado, 1)
+         + (std::uint64_t)_mm256_extract_epi64(acumulado, 2) + (std::uint64_t)_mm256_extract_epi64(acumulado, 3);
+}
+
+// Versiones AVX2 de los kernels: procesan los bloques completos de 4
+// palabras y dejan en i la primera palabra sin procesar.
+MIS_OBJETIVO_AVX2 inline std::uint64_t contar_bits_avx2(const std::uint64_t* a, std::size_t palabras, std::size_t& i) {
+    __m256i acumulado = _mm256_setzero_si256();
+    for (; i + 4 <= palabras; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        acumulado = _mm256_add_epi64(acumulado, _mm256_sad_epu8(contar_bits_bytes(x), _mm256_setzero_si256()));
+    }
+    return sumar_lanes(acumulado);
+}
+
+MIS_OBJETIVO_AVX2 inline std::uint64_t distancia_bits_avx2(const std::uint64_t* a, const std::uint64_t* b,
+                                                             std::size_t palabras, std::size_t& i) {
+    __m256i acumulado = _mm256_setzero_si256();
+    for (; i + 4 <= palabras; i += 4) {
+        __m256i x = _mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acumulado = _mm256_add_epi64(acumulado, _mm256_sad_epu8(contar_bits_bytes(x), _mm256_setzero_si256()));
+    }
+    return sumar_lanes(acumulado);
+}
+
+MIS_OBJETIVO_AVX2 inline bool hay_interseccion_avx2(const std::uint64_t* a, const std::uint64_t* b,
+                                                      std::size_t palabras, std::size_t& i) {
+    for (; i + 4 <= palabras; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        if (!_mm256_testz_si256(x, y)) return true;
+    }
+    return false;
+}
+
+MIS_OBJETIVO_AVX2 inline void restar_bits_avx2(std::uint64_t* a, const std::uint64_t* b,
+                                                 std::size_t palabras, std::size_t& i) {
+    for (; i + 4 <= palabras; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_andnot_si256(y, x));
+    }
+}
+#endif
+
+inline std::size_t contar_bits(const std::uint64_t* a, std::size_t palabras) {
+    std::size_t i = 0;
+    std::uint64_t total = 0;
+#ifdef MIS_USAR_AVX2
+    if (cpu_con_avx2())
+        total = contar_bits_avx2(a, palabras, i);
+#endif
+    for (; i < palabras; ++i)
+        total += __builtin_popcountll(a[i]);
+    return total;
+}
+
+// Cantidad de bits distintos entre a y b.
+inline std::size_t distancia_bits(const std::uint64_t* a, const std::uint64_t* b, std::size_t palabras) {
+    std::size_t i = 0;
+    std::uint64_t total = 0;
+#ifdef MIS_USAR_AVX2
+    if (cpu_con_avx2())
+        total = distancia_bits_avx2(a, b, palabras, i);
+#endif
+    for (; i < palabras; ++i)
+        total += __builtin_popcountll(a[i] ^ b[i]);
+    return total;
+}
+
+// true si a y b tienen algun bit en comun (p. ej. solucion contra la fila de
+// vecinos de un vertice).
+inline bool hay_interseccion(const std::uint64_t* a, const std::uint64_t* b, std::size_t palabras) {
+    std::size_t i = 0;
+#ifdef MIS_USAR_AVX2
+    if (cpu_con_avx2() && hay_interseccion_avx2(a, b, palabras, i))
+        return true;
+#endif
+    for (; i < palabras; ++i)
+        if (a[i] & b[i]) return true;
+    return false;
+}
+
+// a = a AND NOT b (p. ej. sacar de los libres la fila de vecinos de un vertice).
+inline void restar_bits(std::uint64_t* a, const std::uint64_t* b, std::size_t palabras) {
+    std::size_t i = 0;
+#ifdef MIS_USAR_AVX2
+    if (cpu_con_avx2())
+        restar_bits_avx2(a, b, palabras, i);
+#endif
+    for (; i < palabras; ++i)
+        a[i] &= ~b[i];
+}
+
+// Llama f(v) por cada bit v encendido en a, en orden creciente.
+template <typename F>
+inline void recorrer_bits(const std::uint64_t* a, std::size_t palabras, F f) {
+    for (std::size_t i = 0; i < palabras; ++i)
+        for (std::uint64_t w = a[i]; w != 0; w &= w - 1)
+            f((int)(i * 64 + __builtin_ctzll(w)));
+}
+
+struct ConjuntoBits {
+    std::vector<std::uint64_t> palabras;
+
+    void inicializar(int n) { palabras.assign(((std::size_t)n + 63) / 64, 0); }
+
+    bool operator[](int v) const { return (palabras[v >> 6] >> (v & 63)) & 1; }
+    void poner(int v) { palabras[v >> 6] |= (std::uint64_t)1 << (v & 63); }
+    void quitar(int v) { palabras[v >> 6] &= ~((std::uint64_t)1 << (v & 63)); }
+
+    std::size_t num_palabras() const { return palabras.size(); }
+    std::uint64_t palabra(std::size_t i) const { return palabras[i]; }
+    const std::uint64_t* data() const { return palabras.data(); }
+    std::uint64_t* data() { return palabras.data(); }
+
+    int contar() const { return (int)contar_bits(palabras.data(), palabras.size()); }
+
+    int distancia(const ConjuntoBits& otro) const {
+        return (int)distancia_bits(palabras.data(), otro.palabras.data(), palabras.size());
+    }
+
+    bool interseca(const std::uint64_t* fila) const {
+        return hay_interseccion(palabras.data(), fila, palabras.size());
+    }
+
+    void restar(const std::uint64_t* fila) { restar_bits(palabras.data(), fila, palabras.size()); }
+
+    bool vacio() const {
+        for (std::uint64_t w : palabras)
+            if (w != 0) return false;
+        return true;
+    }
+};
+
+// Sorteo sin reemplazo de k vertices fuera de un conjunto de 'miembros'
+// vertices sobre n. Fisher-Yates parcial sobre las posiciones [0, fuera) de
+// una permutacion virtual de los vertices, en la que el r-esimo miembro con
+// indice < fuera se cambio por el r-esimo no miembro con indice >= fuera
+// (hay tantos de uno como de otro). Ese cambio se calcula solo para las
+// posiciones sorteadas, con rank/select sobre conteos acumulados por
+// palabra, y lo que mueve el sorteo se guarda disperso; el costo es
+// O(n / 64 + k log(n / 64)), sin importar el tamanio del conjunto.
+class SorteoComplemento {
+public:
+    // Llama f(v) por cada vertice sorteado, en orden aleatorio.
+    template <typename F>
+    void sortear(const ConjuntoBits& conjunto, int n, int miembros, int k,
+                 std::mt19937_64& generator, F f) {
+        const int fuera = n - miembros;
+        if (k > fuera) k = fuera;
+        if (k <= 0) return;
+        if ((int)permutacion_.size() != n) permutacion_.assign(n, -1);
+
+        palabras_ = conjunto.data();
+        const int num_palabras = (int)conjunto.num_palabras();
+        acumulados_.resize(num_palabras + 1);
+        acumulados_[0] = 0;
+        for (int i = 0; i < num_palabras; ++i)
+            acumulados_[i + 1] = acumulados_[i] + __builtin_popcountll(palabras_[i]);
+        // Cantidad de no miembros con indice < fuera.
+        fuera_antes_ = fuera - rank(fuera);
+
+        for (int i = 0; i < k; ++i) {
+            std::uniform_int_distribution<int> dist(i, fuera - 1);
+            int j = dist(generator);
+            int v = valor(j);
+            fijar(j, valor(i));
+            f(v);
+        }
+        for (int p : tocados_) permutacion_[p] = -1;
+        tocados_.clear();
+    }
+
+private:
+    // permutacion_[p] = -1 si el sorteo no movio la posicion p.
+    std::vector<int> permutacion_;
+    std::vector<int> tocados_;
+    // acumulados_[i] = miembros en las palabras [0, i).
+    std::vector<int> acumulados_;
+    const std::uint64_t* palabras_ = nullptr;
+    int fuera_antes_ = 0;
+
+    // Miembros con indice < p.
+    int rank(int p) const {
+        int r = acumulados_[p >> 6];
+        if (p & 63) r += __builtin_popcountll(palabras_[p >> 6] & (((std::uint64_t)1 << (p & 63)) - 1));
+        return r;
+    }
+
+    // Indice del no miembro numero r (desde 0).
+    int select_fuera(int r) const {
+        int lo = 0, hi = (int)acumulados_.size() - 1;
+        while (hi - lo > 1) {
+            int mid = (lo + hi) / 2;
+            if (mid * 64 - acumulados_[mid] <= r) lo = mid;
+            else hi = mid;
+        }
+        std::uint64_t libres = ~palabras_[lo];
+        for (int resto = r - (lo * 64 - acumulados_[lo]); resto > 0; --resto)
+            libres &= libres - 1;
+        return lo * 64 + __builtin_ctzll(libres);
+    }
+
+    // Vertice en la posicion p < fuera de la permutacion virtual.
+    int valor(int p) const {
+        if (permutacion_[p] != -1) return permutacion_[p];
+        if (!((palabras_[p >> 6] >> (p & 63)) & 1)) return p;
+        return select_fuera(fuera_antes_ + rank(p));
+    }
+
+    void fijar(int p, int v) {
+        if (permutacion_[p] == -1) tocados_.push_back(p);
+        permutacion_[p] = v;
+    }
+};
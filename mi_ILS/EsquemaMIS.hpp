@@ -5,10 +5,66 @@
 #include <numeric>
 #include <string>
 #include <chrono> // Usamos la librería estándar de C++ para el tiempo
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <utility>
+#include "optimizationtools/utils/utils.hpp"
 #include "InstanciaMIS.hpp"
 
 namespace localsearchsolver {
 
+// Mejor conjunto independiente conocido, compartido entre las islas (ILS
+// independientes) que trabajan sobre el mismo grafo. Leer el mejor tamanio
+// es un load atomico; el mutex solo se toma cuando alguien mejora o cuando
+// una isla reinicia desde el mejor global.
+class IntercambioMIS {
+public:
+    using reloj = std::chrono::high_resolution_clock;
+
+    // Si 'compartir_solucion' es false solo se lleva el tamanio y el tiempo.
+    explicit IntercambioMIS(bool compartir_solucion = false)
+        : compartir_solucion_(compartir_solucion), inicio_(reloj::now()) {}
+
+    // Solucion: cualquier tipo con 'size' y 'vertices' (EsquemaMIS y
+    // EsquemaMISDenso).
+    template <typename Solucion>
+    void publicar(const Solucion& s) {
+        if (s.size <= mejor_tamanio_.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (s.size <= mejor_tamanio_.load(std::memory_order_relaxed)) return;
+        std::chrono::duration<double> elapsed = reloj::now() - inicio_;
+        tiempo_al_mejor_ = elapsed.count();
+        if (compartir_solucion_)
+            mejor_vertices_.assign(s.vertices.begin(), s.vertices.end());
+        mejor_tamanio_.store(s.size, std::memory_order_release);
+    }
+
+    int mejor_tamanio() const { return mejor_tamanio_.load(std::memory_order_acquire); }
+
+    bool comparte_solucion() const { return compartir_solucion_; }
+
+    // Vertices del mejor conjunto publicado (vacio si no se comparten).
+    std::vector<int> mejor_vertices() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return mejor_vertices_;
+    }
+
+    // Segundos desde la creacion del intercambio hasta la ultima mejora.
+    double tiempo_al_mejor() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tiempo_al_mejor_;
+    }
+
+private:
+    bool compartir_solucion_;
+    reloj::time_point inicio_;
+    std::atomic<int> mejor_tamanio_{0};
+    mutable std::mutex mutex_;
+    std::vector<int> mejor_vertices_;
+    double tiempo_al_mejor_ = 0.0;
+};
+
 struct EsquemaMIS
 {
     using Solution = InstanciaMIS::Solucion;
@@ -16,133 +72,493 @@ struct EsquemaMIS
     using GlobalCost = int;
 
     const Graph& graph;
+    InstanciaMIS instancia;
     double alpha = 0.3;
+    // Cantidad de vertices forzados por perturbacion.
     int fuerza_perturbacion = 2;
+    // Cantidad maxima de perturbaciones generadas por solucion; al agotarlas
+    // sin mejorar, el ILS reinicia desde una nueva solucion GRASP.
+    int numero_perturbaciones = 1000;
 
     // --- Miembros de seguimiento ---
-    // 'mutable' permite modificar estos valores desde funciones 'const' como global_cost
-    mutable int best_cost_so_far = 0; // Guardamos el costo (negativo del tamaño)
-    mutable double time_to_best_found = 0.0;
-    mutable std::chrono::high_resolution_clock::time_point start_time;
-    mutable bool is_chrono_started = false;
+    // Tamanio del mejor conjunto encontrado por este esquema. Cada isla tiene
+    // su propio esquema, asi que no se comparte entre hilos.
+    int mejor_tamanio_propio = 0;
+    // Registro del mejor global; las islas de un mismo grafo comparten el
+    // mismo intercambio.
+    std::shared_ptr<IntercambioMIS> intercambio;
 
-    EsquemaMIS(const Graph& g) : graph(g) {}
+    EsquemaMIS(const Graph& g, std::shared_ptr<IntercambioMIS> intercambio_compartido = nullptr)
+        : graph(g), instancia(g),
+          intercambio(intercambio_compartido ? intercambio_compartido : std::make_shared<IntercambioMIS>()) {}
 
-    // --- El "espía" en la función objetivo ---
-    GlobalCost global_cost(const Solution& s) const
-    {
-        // Inicia el cronómetro en la primera llamada
-        if (!is_chrono_started) {
-            start_time = std::chrono::high_resolution_clock::now();
-            is_chrono_started = true;
-        }
+    // Sin efectos secundarios: se llama en cada comparacion del ILS y del
+    // SolutionPool.
+    GlobalCost global_cost(const Solution& s) const { return -s.size; }
 
-        int current_cost = -s.size;
-
-        // Comprueba si hemos encontrado un nuevo récord
-        if (current_cost < best_cost_so_far) {
-            best_cost_so_far = current_cost;
-            auto now = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> elapsed = now - start_time;
-            time_to_best_found = elapsed.count();
-        }
-        return current_cost;
+    // Evento de mejora: se engancha a Parameters::new_solution_callback, que
+    // el AlgorithmFormatter llama solo cuando cambia la mejor solucion.
+    void registrar_mejora(const Solution& s) {
+        if (s.size <= mejor_tamanio_propio) return;
+        mejor_tamanio_propio = s.size;
+        intercambio->publicar(s);
     }
 
     // --- Métodos para obtener los resultados ---
-    int get_best_solution_size() const { return -best_cost_so_far; }
-    double get_time_to_best() const { return time_to_best_found; }
+    int get_best_solution_size() const { return intercambio->mejor_tamanio(); }
+    double get_time_to_best() const { return intercambio->tiempo_al_mejor(); }
 
     Solution empty_solution() const {
         Solution s;
-        s.in_set.assign(graph.num_vertices, false);
-        s.size = 0;
+        s.inicializar(graph.num_vertices);
         return s;
     }
 
+    // GRASP: en cada paso se elige al azar un vertice disponible cuyo grado
+    // dinamico (vecinos aun disponibles) sea <= min + alpha * (max - min).
+    //
+    // Los vertices disponibles se guardan en 'orden' agrupados en cubetas por
+    // grado dinamico (cubeta d = orden[inicio[d] .. inicio[d + 1] - 1]); los
+    // ya no disponibles quedan al principio, antes de inicio[0]. Como la RCL
+    // son las cubetas min..umbral, es un rango contiguo y se sortea en O(1).
+    // Bajar el grado de un vertice cuesta O(1) y sacar un vertice de grado d
+    // cuesta O(d), asi la construccion completa es O(n + m).
+    //
+    // Si otra isla encontro un conjunto mejor que el mejor de esta, el
+    // reinicio parte desde ese conjunto en vez de construir uno nuevo.
     Solution initial_solution(int, std::mt19937_64& generator) {
-        Solution sol;
-        sol.in_set.assign(graph.num_vertices, false);
-        sol.size = 0;
-        std::vector<bool> nodos_disponibles(graph.num_vertices, true);
-        while (true) {
-            std::vector<std::pair<int, int>> candidatos_con_grado;
-            int min_grado = -1, max_grado = -1;
-            for (int v = 0; v < graph.num_vertices; ++v) {
-                if (nodos_disponibles[v]) {
-                    int grado_actual = 0;
-                    for (int u : graph.adj_list[v]) {
-                        if (nodos_disponibles[u]) grado_actual++;
-                    }
-                    candidatos_con_grado.push_back({v, grado_actual});
-                    if (min_grado == -1 || grado_actual < min_grado) min_grado = grado_actual;
-                    if (max_grado == -1 || grado_actual > max_grado) max_grado = grado_actual;
+        if (mejor_tamanio_propio > 0 && intercambio->comparte_solucion()
+                && intercambio->mejor_tamanio() > mejor_tamanio_propio) {
+            Solution sol = empty_solution();
+            for (int v : intercambio->mejor_vertices())
+                instancia.agregar(sol, v);
+            return sol;
+        }
+
+        Solution sol = empty_solution();
+        const int n = graph.num_vertices;
+
+        std::vector<int> grado(n), orden(n), pos(n);
+        int max_grado = 0;
+        for (int v = 0; v < n; ++v) {
+            grado[v] = graph.grado(v);
+            max_grado = std::max(max_grado, grado[v]);
+        }
+        std::vector<int> inicio(max_grado + 2, 0);
+        for (int v = 0; v < n; ++v) inicio[grado[v] + 1]++;
+        for (int d = 0; d <= max_grado; ++d) inicio[d + 1] += inicio[d];
+        {
+            std::vector<int> siguiente(inicio.begin(), inicio.end() - 1);
+            for (int v = 0; v < n; ++v) {
+                pos[v] = siguiente[grado[v]]++;
+                orden[pos[v]] = v;
+            }
+        }
+
+        // Mueve v al final de la cubeta de grado anterior.
+        auto bajar = [&](int v) {
+            int d = grado[v];
+            int i = inicio[d];
+            int u = orden[i];
+            orden[pos[v]] = u;
+            pos[u] = pos[v];
+            orden[i] = v;
+            pos[v] = i;
+            inicio[d]++;
+            grado[v]--;
+        };
+
+        std::vector<int> quitados;
+        int min_grado = 0, max_actual = max_grado;
+        while (inicio[0] < n) {
+            while (inicio[max_actual] == inicio[max_actual + 1]) max_actual--;
+            while (inicio[min_grado] == inicio[min_grado + 1]) min_grado++;
+            double umbral = min_grado + alpha * (max_actual - min_grado);
+            int limite = std::min(max_actual, (int)umbral);
+            std::uniform_int_distribution<int> dist(inicio[min_grado], inicio[limite + 1] - 1);
+            int nodo_elegido = orden[dist(generator)];
+
+            quitados.clear();
+            quitados.push_back(nodo_elegido);
+            for (int u : graph.vecinos(nodo_elegido))
+                if (sol.libres.contiene(u)) quitados.push_back(u);
+            instancia.agregar(sol, nodo_elegido);
+            for (int q : quitados)
+                while (grado[q] >= 0) bajar(q);
+            for (int q : quitados) {
+                for (int w : graph.vecinos(q)) {
+                    if (!sol.libres.contiene(w)) continue;
+                    bajar(w);
+                    min_grado = std::min(min_grado, grado[w]);
                 }
             }
-            if (candidatos_con_grado.empty()) break;
-            double umbral = min_grado + alpha * (max_grado - min_grado);
-            std::vector<int> rcl;
-            for (const auto& par : candidatos_con_grado) {
-                if (par.second <= umbral) rcl.push_back(par.first);
+        }
+        return sol;
+    }
+
+    // Busqueda local con dos movimientos:
+    // - insercion: agregar vertices libres (tightness 0) hasta ser maximal,
+    // - (1,2)-swap: quitar un vertice x de la solucion y agregar dos vecinos
+    //   1-tight de x no adyacentes entre si (Andrade, Resende y Werneck, 2012).
+    // Solo se examinan los vertices de 'candidatos_'; tras cada mejora se
+    // agregan los vertices cuya vecindad 1-tight pudo cambiar. Examinar x
+    // cuesta O(grado(x) + suma de grado(u) para u 1-tight vecino de x), y
+    // cada vertice 1-tight tiene un solo vecino en la solucion, asi una
+    // pasada completa cuesta O(m).
+    void local_search(Solution& s, std::mt19937_64& generator) {
+        preparar_auxiliares();
+        for (int v : s.vertices) candidatos_.agregar(v);
+        agregar_libres(s, generator);
+        mejoras_2(s, generator);
+    }
+
+    // Busqueda local tras una perturbacion: solo se examinan los vertices de
+    // la solucion cercanos a la region que toco apply_perturbation, y los
+    // vertices forzados no pueden salir (si no, el (1,2)-swap desharia la
+    // perturbacion).
+    void local_search(Solution& s, std::mt19937_64& generator, const Perturbation& perturbation) {
+        if (perturbation.vertex == -1) {
+            local_search(s, generator);
+            return;
+        }
+        preparar_auxiliares();
+        for (int f : forzados_) tabu_[f] = 1;
+        for (int r : region_) {
+            if (s.in_set[r]) candidatos_.agregar(r);
+            for (int y : graph.vecinos(r))
+                marcar_duenio(s, y);
+        }
+        agregar_libres(s, generator);
+        mejoras_2(s, generator);
+        for (int f : forzados_) tabu_[f] = 0;
+    }
+
+    // Perturbaciones: hasta numero_perturbaciones vertices distintos fuera
+    // de la solucion, sorteados sin reemplazo y en orden aleatorio.
+    std::vector<Perturbation> perturbations(const Solution& s, std::mt19937_64& generator) {
+        std::vector<Perturbation> perturbations;
+        perturbations.reserve(std::max(0, std::min(numero_perturbaciones, graph.num_vertices - s.size)));
+        sorteo_.sortear(s.in_set, graph.num_vertices, s.size, numero_perturbaciones, generator,
+                        [&](int v) { perturbations.push_back(perturbacion(s, v)); });
+        return perturbations;
+    }
+
+    // Fuerza perturbation.vertex y hasta fuerza_perturbacion - 1 vertices mas
+    // de su bola de radio 2 (independientes entre si), expulsando de la
+    // solucion a sus vecinos. Costo proporcional a la bola, no a n.
+    void apply_perturbation(Solution& s, const Perturbation& perturbation, std::mt19937_64& generator) {
+        preparar_auxiliares();
+        forzados_.clear();
+        region_.clear();
+        int v = perturbation.vertex;
+        if (v == -1 || s.in_set[v]) return;
+        forzados_.push_back(v);
+
+        if (fuerza_perturbacion > 1) {
+            bola_.clear();
+            for (int y : graph.vecinos(v)) {
+                for (int z : graph.vecinos(y)) {
+                    if (z == v || s.in_set[z] || tabu_[z]) continue;
+                    tabu_[z] = 1;
+                    bola_.push_back(z);
+                }
             }
-            if (rcl.empty() && !candidatos_con_grado.empty()) {
-                 rcl.push_back(candidatos_con_grado[0].first);
-            } else if (rcl.empty()){
-                break;
+            for (int z : bola_) tabu_[z] = 0;
+            std::shuffle(bola_.begin(), bola_.end(), generator);
+            for (int z : bola_) {
+                if ((int)forzados_.size() >= fuerza_perturbacion) break;
+                bool independiente = true;
+                for (int f : forzados_)
+                    if (graph.son_adyacentes(z, f)) independiente = false;
+                if (independiente) forzados_.push_back(z);
             }
-            std::uniform_int_distribution<int> dist(0, rcl.size() - 1);
-            int nodo_elegido = rcl[dist(generator)];
-            sol.in_set[nodo_elegido] = true;
-            sol.size++;
-            nodos_disponibles[nodo_elegido] = false;
-            for (int vecino : graph.adj_list[nodo_elegido]) {
-                nodos_disponibles[vecino] = false;
+        }
+
+        for (int f : forzados_) {
+            for (int u : graph.vecinos(f)) {
+                if (s.in_set[u]) {
+                    quitar_anotado(s, u);
+                    region_.push_back(u);
+                }
             }
+            agregar_anotado(s, f);
+            region_.push_back(f);
         }
-        return sol;
     }
 
-    void local_search(Solution& s, std::mt19937_64&) {
-        bool improved = true;
-        while (improved) {
-            improved = false;
-            for (int v = 0; v < graph.num_vertices; ++v) {
-                if (!s.in_set[v]) {
-                    bool can_add = true;
-                    for (int u : graph.adj_list[v]) {
-                        if (s.in_set[u]) {
-                            can_add = false;
-                            break;
-                        }
-                    }
-                    if (can_add) {
-                        s.in_set[v] = true;
-                        s.size++;
-                        improved = true;
-                    }
-                }
+    /*
+     * Rollback (iterated local search)
+     */
+
+    // Desde start_journal se anotan los vertices que entran (v) y salen (~v)
+    // de s en apply_perturbation y local_search; rollback los deshace en
+    // orden inverso, en tiempo proporcional a los cambios y no a n.
+    void start_journal(Solution& s) {
+        diario_.clear();
+        en_diario_ = &s;
+    }
+
+    void rollback(Solution& s) {
+        en_diario_ = nullptr;
+        for (auto it = diario_.rbegin(); it != diario_.rend(); ++it) {
+            if (*it >= 0) instancia.quitar(s, *it);
+            else instancia.agregar(s, ~*it);
+        }
+        diario_.clear();
+    }
+
+    /*
+     * Genetic local search
+     */
+
+    // Cruce que preserva la independencia: entran los vertices comunes a
+    // ambos padres (independientes por estar en el primero) y luego, en
+    // orden aleatorio, los de un solo padre que sigan siendo agregables.
+    Solution crossover(const Solution& padre_1, const Solution& padre_2, std::mt19937_64& generator) {
+        Solution s = empty_solution();
+        const std::size_t w = padre_1.in_set.num_palabras();
+        std::vector<int> de_uno;
+        for (std::size_t i = 0; i < w; ++i) {
+            std::uint64_t a = padre_1.in_set.palabra(i), b = padre_2.in_set.palabra(i);
+            for (std::uint64_t x = a & b; x != 0; x &= x - 1)
+                instancia.agregar(s, (int)(i * 64 + __builtin_ctzll(x)));
+            for (std::uint64_t x = a ^ b; x != 0; x &= x - 1)
+                de_uno.push_back((int)(i * 64 + __builtin_ctzll(x)));
+        }
+        std::shuffle(de_uno.begin(), de_uno.end(), generator);
+        for (int v : de_uno) instancia.agregar(s, v);
+        return s;
+    }
+
+    // Distancia de Hamming entre los conjuntos.
+    int distance(const Solution& s1, const Solution& s2) const { return s1.distancia(s2); }
+
+    /*
+     * Best first local search
+     */
+
+    // Solucion compacta: las palabras de in_set.
+    using CompactSolution = std::vector<std::uint64_t>;
+
+    struct CompactSolutionHasher
+    {
+        std::hash<std::uint64_t> hasher;
+
+        bool operator()(
+                const std::shared_ptr<CompactSolution>& compact_solution_1,
+                const std::shared_ptr<CompactSolution>& compact_solution_2) const
+        {
+            return *compact_solution_1 == *compact_solution_2;
+        }
+
+        std::size_t operator()(const std::shared_ptr<CompactSolution>& compact_solution) const
+        {
+            std::size_t hash = 0;
+            for (std::uint64_t palabra : *compact_solution)
+                optimizationtools::hash_combine(hash, hasher(palabra));
+            return hash;
+        }
+    };
+
+    CompactSolutionHasher compact_solution_hasher() const { return CompactSolutionHasher(); }
+
+    // Huella de 128 bits para el historial por huellas: dos cadenas de
+    // hashes independientes (finalizador de splitmix64) sobre las palabras.
+    std::pair<std::uint64_t, std::uint64_t> compact_solution_fingerprint(
+            const CompactSolution& compact_solution) const {
+        auto mezclar = [](std::uint64_t x) {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        };
+        std::uint64_t h1 = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h2 = 0xc2b2ae3d27d4eb4fULL;
+        for (std::uint64_t palabra : compact_solution) {
+            h1 = mezclar(h1 ^ palabra);
+            h2 = mezclar(h2 + (palabra << 32 | palabra >> 32) + 0x165667b19e3779f9ULL);
+        }
+        return {h1, h2};
+    }
+
+    CompactSolution solution2compact(const Solution& s) const { return s.in_set.palabras; }
+
+    Solution compact2solution(const CompactSolution& compact_solution) const {
+        Solution s = empty_solution();
+        recorrer_bits(compact_solution.data(), compact_solution.size(), [this, &s](int v) {
+            instancia.agregar(s, v);
+        });
+        return s;
+    }
+
+    // Delta entre soluciones compactas: los vertices que cambian de estado.
+    using CompactSolutionDelta = std::vector<int>;
+
+    CompactSolutionDelta compact_solution_delta(
+            const CompactSolution& compact_solution_1,
+            const CompactSolution& compact_solution_2) const {
+        CompactSolutionDelta delta;
+        for (std::size_t i = 0; i < compact_solution_1.size(); ++i) {
+            std::uint64_t palabra = compact_solution_1[i] ^ compact_solution_2[i];
+            recorrer_bits(&palabra, 1, [&delta, i](int v) { delta.push_back((int)(i * 64) + v); });
+        }
+        return delta;
+    }
+
+    void apply_compact_solution_delta(
+            CompactSolution& compact_solution,
+            const CompactSolutionDelta& delta) const {
+        for (int v : delta)
+            compact_solution[v / 64] ^= std::uint64_t(1) << (v % 64);
+    }
+
+    // Dos perturbaciones son la misma si fuerzan el mismo vertice.
+    struct PerturbationHasher
+    {
+        std::hash<int> hasher;
+
+        bool hashable(const Perturbation& perturbation) const { return perturbation.vertex != -1; }
+
+        bool operator()(const Perturbation& perturbation_1, const Perturbation& perturbation_2) const
+        {
+            return perturbation_1.vertex == perturbation_2.vertex;
+        }
+
+        std::size_t operator()(const Perturbation& perturbation) const
+        {
+            return hasher(perturbation.vertex);
+        }
+    };
+
+    PerturbationHasher perturbation_hasher() const { return PerturbationHasher(); }
+
+private:
+    // Solucion x a examinar por el (1,2)-swap.
+    ConjuntoIndexado candidatos_;
+    // Vecinos 1-tight del vertice examinado.
+    std::vector<int> uno_tight_;
+    // marca_[y] = 1 si y esta en uno_tight_, 2 si ademas es vecino del
+    // vertice u probado por companero_no_adyacente; 0 si no.
+    std::vector<char> marca_;
+    // tabu_[v] = 1 si v no puede salir de la solucion en esta busqueda local
+    // (tambien se usa como marca temporal al armar la bola).
+    std::vector<char> tabu_;
+    std::vector<int> bola_;
+    // Vertices forzados por la ultima perturbacion aplicada y region que
+    // toco (forzados y expulsados); los lee la busqueda local siguiente.
+    std::vector<int> forzados_;
+    std::vector<int> region_;
+    SorteoComplemento sorteo_;
+    // Solucion con diario abierto y sus cambios (ver rollback).
+    const Solution* en_diario_ = nullptr;
+    std::vector<int> diario_;
+
+    void agregar_anotado(Solution& s, int v) {
+        if (instancia.agregar(s, v) && &s == en_diario_) diario_.push_back(v);
+    }
+
+    void quitar_anotado(Solution& s, int x) {
+        if (instancia.quitar(s, x) && &s == en_diario_) diario_.push_back(~x);
+    }
+
+    void preparar_auxiliares() {
+        if ((int)tabu_.size() != graph.num_vertices) {
+            candidatos_.inicializar(graph.num_vertices);
+            tabu_.assign(graph.num_vertices, 0);
+            marca_.assign(graph.num_vertices, 0);
+        }
+        candidatos_.limpiar();
+    }
+
+    Perturbation perturbacion(const Solution& s, int v) const {
+        Perturbation p;
+        p.vertex = v;
+        p.global_cost = -(s.size + 1 - s.tightness[v]);
+        return p;
+    }
+
+    // Si y esta fuera de la solucion y es 1-tight, su unico vecino en la
+    // solucion pasa a ser candidato del (1,2)-swap.
+    void marcar_duenio(const Solution& s, int y) {
+        if (s.in_set[y] || s.tightness[y] != 1) return;
+        for (int z : graph.vecinos(y)) {
+            if (s.in_set[z]) {
+                candidatos_.agregar(z);
+                return;
             }
         }
     }
 
-    void apply_perturbation(Solution& s, const Perturbation&, std::mt19937_64& generator) {
-        std::vector<int> nodos_en_solucion;
-        for (int i = 0; i < graph.num_vertices; ++i) {
-            if (s.in_set[i]) nodos_en_solucion.push_back(i);
+    void agregar_libres(Solution& s, std::mt19937_64& generator) {
+        while (!s.libres.empty()) {
+            std::uniform_int_distribution<int> dist(0, s.libres.size() - 1);
+            int v = s.libres[dist(generator)];
+            agregar_anotado(s, v);
+            candidatos_.agregar(v);
         }
-        if (nodos_en_solucion.empty()) return;
-        std::shuffle(nodos_en_solucion.begin(), nodos_en_solucion.end(), generator);
-        for (int i = 0; i < fuerza_perturbacion && i < nodos_en_solucion.size(); ++i) {
-            int nodo_a_quitar = nodos_en_solucion[i];
-            if (s.in_set[nodo_a_quitar]) {
-                s.in_set[nodo_a_quitar] = false;
-                s.size--;
+    }
+
+    // Busca w en uno_tight_ (marcado en marca_) distinto de u y no adyacente
+    // a u. Se cuentan los vecinos de u en la lista, O(grado(u)); solo si
+    // son menos que k - 1 se recorre la lista, O(k), y eso pasa a lo mas
+    // una vez por vertice examinado.
+    int companero_no_adyacente(int u) {
+        int k = (int)uno_tight_.size();
+        int vecinos_en_lista = 0;
+        for (int y : graph.vecinos(u)) {
+            if (marca_[y] == 1) {
+                marca_[y] = 2;
+                vecinos_en_lista++;
             }
         }
+        int w = -1;
+        if (vecinos_en_lista < k - 1) {
+            for (int z : uno_tight_) {
+                if (z != u && marca_[z] == 1) {
+                    w = z;
+                    break;
+                }
+            }
+        }
+        for (int y : graph.vecinos(u))
+            if (marca_[y] == 2) marca_[y] = 1;
+        return w;
+    }
+
+    void mejoras_2(Solution& s, std::mt19937_64& generator) {
+        while (!candidatos_.empty()) {
+            std::uniform_int_distribution<int> dist(0, candidatos_.size() - 1);
+            int x = candidatos_[dist(generator)];
+            candidatos_.quitar(x);
+            if (!s.in_set[x] || tabu_[x]) continue;
+
+            uno_tight_.clear();
+            for (int y : graph.vecinos(x))
+                if (s.tightness[y] == 1) uno_tight_.push_back(y);
+            if (uno_tight_.size() < 2) continue;
+
+            int u = -1, w = -1;
+            int k = (int)uno_tight_.size();
+            int inicio = std::uniform_int_distribution<int>(0, k - 1)(generator);
+            for (int y : uno_tight_) marca_[y] = 1;
+            for (int i = 0; i < k && w == -1; ++i) {
+                u = uno_tight_[(inicio + i) % k];
+                w = companero_no_adyacente(u);
+            }
+            for (int y : uno_tight_) marca_[y] = 0;
+            if (w == -1) continue;
+
+            quitar_anotado(s, x);
+            agregar_anotado(s, u);
+            agregar_anotado(s, w);
+            candidatos_.agregar(u);
+            candidatos_.agregar(w);
+            agregar_libres(s, generator);
+            // Los vecinos de x que quedaron 1-tight pueden habilitar un swap
+            // en su unico vecino de la solucion.
+            for (int y : graph.vecinos(x))
+                marcar_duenio(s, y);
+        }
     }
-    
-    std::vector<Perturbation> perturbations(const Solution&, std::mt19937_64&) { return {}; }
-    void local_search(Solution& s, std::mt19937_64& g, const Perturbation&) { local_search(s, g); }
 };
 
 inline std::string to_string(const EsquemaMIS&, const int& cost) { return std::to_string(-cost); }
@@ -0,0 +1,329 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "InstanciaMIS.hpp"
+#include "ConjuntoBits.hpp"
+#include "GrafoDenso.hpp"
+#include "EsquemaMIS.hpp"
+
+namespace localsearchsolver {
+
+// Variante de EsquemaMIS para grafos densos (GrafoDenso). Los conjuntos de la
+// solucion (en la solucion, libres, 1-tight) son filas de bits, asi que sacar
+// de los libres la vecindad de un vertice, armar los vecinos 1-tight de x y
+// buscar un companero no adyacente para el (1,2)-swap son AND / AND-NOT
+// palabra a palabra en vez de recorridos de listas de miles de vecinos.
+struct EsquemaMISDenso
+{
+    struct Solucion {
+        ConjuntoBits in_set;
+        // Fuera de la solucion y sin vecinos en ella.
+        ConjuntoBits libres;
+        // Fuera de la solucion y con exactamente un vecino en ella.
+        ConjuntoBits uno_tight;
+        std::vector<int> tightness;
+        ConjuntoIndexado vertices;
+        int size = 0;
+
+        void inicializar(int n) {
+            in_set.inicializar(n);
+            libres.inicializar(n);
+            for (int v = 0; v < n; ++v) libres.poner(v);
+            uno_tight.inicializar(n);
+            tightness.assign(n, 0);
+            vertices.inicializar(n);
+            size = 0;
+        }
+
+        int distancia(const Solucion& otra) const { return in_set.distancia(otra.in_set); }
+    };
+
+    using Solution = Solucion;
+    using Perturbation = InstanciaMIS::Perturbacion;
+    using GlobalCost = int;
+
+    const GrafoDenso& graph;
+    double alpha = 0.3;
+    // Cantidad de vertices forzados por perturbacion.
+    int fuerza_perturbacion = 2;
+    // Cantidad maxima de perturbaciones generadas por solucion.
+    int numero_perturbaciones = 1000;
+
+    int mejor_tamanio_propio = 0;
+    std::shared_ptr<IntercambioMIS> intercambio;
+
+    EsquemaMISDenso(const GrafoDenso& g, std::shared_ptr<IntercambioMIS> intercambio_compartido = nullptr)
+        : graph(g),
+          intercambio(intercambio_compartido ? intercambio_compartido : std::make_shared<IntercambioMIS>()) {}
+
+    GlobalCost global_cost(const Solution& s) const { return -s.size; }
+
+    void registrar_mejora(const Solution& s) {
+        if (s.size <= mejor_tamanio_propio) return;
+        mejor_tamanio_propio = s.size;
+        intercambio->publicar(s);
+    }
+
+    int get_best_solution_size() const { return intercambio->mejor_tamanio(); }
+    double get_time_to_best() const { return intercambio->tiempo_al_mejor(); }
+
+    bool agregar(Solution& s, int v) const {
+        if (!s.libres[v]) return false;
+        s.in_set.poner(v);
+        s.size++;
+        s.vertices.agregar(v);
+        s.libres.quitar(v);
+        s.libres.restar(graph.fila(v));
+        recorrer_bits(graph.fila(v), graph.palabras_por_fila, [&s](int u) {
+            int t = ++s.tightness[u];
+            if (t == 1) s.uno_tight.poner(u);
+            else if (t == 2) s.uno_tight.quitar(u);
+        });
+        return true;
+    }
+
+    bool quitar(Solution& s, int x) const {
+        if (!s.in_set[x]) return false;
+        s.in_set.quitar(x);
+        s.size--;
+        s.vertices.quitar(x);
+        recorrer_bits(graph.fila(x), graph.palabras_por_fila, [&s](int u) {
+            int t = --s.tightness[u];
+            if (t == 1) {
+                s.uno_tight.poner(u);
+            } else if (t == 0) {
+                s.uno_tight.quitar(u);
+                s.libres.poner(u);
+            }
+        });
+        if (s.tightness[x] == 0) s.libres.poner(x);
+        else if (s.tightness[x] == 1) s.uno_tight.poner(x);
+        return true;
+    }
+
+    Solution empty_solution() const {
+        Solution s;
+        s.inicializar(graph.num_vertices);
+        return s;
+    }
+
+    // GRASP con la misma regla que EsquemaMIS (RCL por grado dinamico). Los
+    // disponibles son una fila de bits: elegir un vertice los recorta con un
+    // AND-NOT y los grados se bajan recorriendo fila(q) AND disponibles.
+    Solution initial_solution(int, std::mt19937_64& generator) {
+        if (mejor_tamanio_propio > 0 && intercambio->comparte_solucion()
+                && intercambio->mejor_tamanio() > mejor_tamanio_propio) {
+            Solution sol = empty_solution();
+            for (int v : intercambio->mejor_vertices())
+                agregar(sol, v);
+            return sol;
+        }
+
+        Solution sol = empty_solution();
+        const std::size_t w = graph.palabras_por_fila;
+        ConjuntoBits disponibles = sol.libres;
+        std::vector<int> grado(graph.grados);
+        std::vector<int> rcl, quitados;
+
+        while (!disponibles.vacio()) {
+            int min_grado = graph.num_vertices, max_grado = 0;
+            recorrer_bits(disponibles.data(), w, [&](int v) {
+                min_grado = std::min(min_grado, grado[v]);
+                max_grado = std::max(max_grado, grado[v]);
+            });
+            double umbral = min_grado + alpha * (max_grado - min_grado);
+            rcl.clear();
+            recorrer_bits(disponibles.data(), w, [&](int v) {
+                if (grado[v] <= umbral) rcl.push_back(v);
+            });
+            std::uniform_int_distribution<int> dist(0, (int)rcl.size() - 1);
+            int nodo_elegido = rcl[dist(generator)];
+
+            quitados.clear();
+            quitados.push_back(nodo_elegido);
+            const std::uint64_t* f = graph.fila(nodo_elegido);
+            for (std::size_t i = 0; i < w; ++i)
+                for (std::uint64_t b = f[i] & disponibles.palabra(i); b != 0; b &= b - 1)
+                    quitados.push_back((int)(i * 64 + __builtin_ctzll(b)));
+            agregar(sol, nodo_elegido);
+            disponibles.quitar(nodo_elegido);
+            disponibles.restar(f);
+
+            for (int q : quitados) {
+                const std::uint64_t* fq = graph.fila(q);
+                for (std::size_t i = 0; i < w; ++i)
+                    for (std::uint64_t b = fq[i] & disponibles.palabra(i); b != 0; b &= b - 1)
+                        grado[i * 64 + __builtin_ctzll(b)]--;
+            }
+        }
+        return sol;
+    }
+
+    // Misma busqueda local que EsquemaMIS (insercion + (1,2)-swap). Las
+    // soluciones en grafos densos son chicas, asi que todos sus vertices se
+    // examinan en cada pasada.
+    void local_search(Solution& s, std::mt19937_64& generator) {
+        preparar_auxiliares();
+        for (int v : s.vertices) candidatos_.agregar(v);
+        agregar_libres(s, generator);
+        mejoras_2(s, generator);
+    }
+
+    // Tras una perturbacion los vertices forzados no pueden salir.
+    void local_search(Solution& s, std::mt19937_64& generator, const Perturbation& perturbation) {
+        if (perturbation.vertex == -1) {
+            local_search(s, generator);
+            return;
+        }
+        preparar_auxiliares();
+        for (int f : forzados_) tabu_[f] = 1;
+        for (int v : s.vertices) candidatos_.agregar(v);
+        agregar_libres(s, generator);
+        mejoras_2(s, generator);
+        for (int f : forzados_) tabu_[f] = 0;
+    }
+
+    // Hasta numero_perturbaciones vertices distintos fuera de la solucion,
+    // sorteados sin reemplazo y en orden aleatorio.
+    std::vector<Perturbation> perturbations(const Solution& s, std::mt19937_64& generator) {
+        std::vector<Perturbation> perturbations;
+        perturbations.reserve(std::max(0, std::min(numero_perturbaciones, graph.num_vertices - s.size)));
+        sorteo_.sortear(s.in_set, graph.num_vertices, s.size, numero_perturbaciones, generator,
+                        [&](int v) { perturbations.push_back(perturbacion(s, v)); });
+        return perturbations;
+    }
+
+    // Fuerza perturbation.vertex y hasta fuerza_perturbacion - 1 vertices al
+    // azar no adyacentes a los ya forzados (en un grafo denso la bola de
+    // radio 2 es casi todo el grafo), expulsando a sus vecinos.
+    void apply_perturbation(Solution& s, const Perturbation& perturbation, std::mt19937_64& generator) {
+        preparar_auxiliares();
+        forzados_.clear();
+        int v = perturbation.vertex;
+        if (v == -1 || s.in_set[v]) return;
+        forzados_.push_back(v);
+
+        std::uniform_int_distribution<int> dist(0, graph.num_vertices - 1);
+        for (int intento = 0; intento < 4 * fuerza_perturbacion
+                && (int)forzados_.size() < fuerza_perturbacion; ++intento) {
+            int z = dist(generator);
+            if (s.in_set[z]) continue;
+            bool independiente = true;
+            for (int f : forzados_)
+                if (z == f || graph.son_adyacentes(z, f)) independiente = false;
+            if (independiente) forzados_.push_back(z);
+        }
+
+        const std::size_t w = graph.palabras_por_fila;
+        for (int f : forzados_) {
+            expulsados_.clear();
+            const std::uint64_t* fila = graph.fila(f);
+            for (std::size_t i = 0; i < w; ++i)
+                for (std::uint64_t b = fila[i] & s.in_set.palabra(i); b != 0; b &= b - 1)
+                    expulsados_.push_back((int)(i * 64 + __builtin_ctzll(b)));
+            for (int u : expulsados_) quitar(s, u);
+            agregar(s, f);
+        }
+    }
+
+private:
+    ConjuntoIndexado candidatos_;
+    std::vector<char> tabu_;
+    // Vecinos 1-tight del vertice examinado, como fila de bits y como lista.
+    std::vector<std::uint64_t> fila_uno_tight_;
+    std::vector<int> uno_tight_;
+    std::vector<int> expulsados_;
+    // Vertices forzados por la ultima perturbacion aplicada; los lee la
+    // busqueda local siguiente.
+    std::vector<int> forzados_;
+    SorteoComplemento sorteo_;
+
+    void preparar_auxiliares() {
+        if ((int)tabu_.size() != graph.num_vertices) {
+            candidatos_.inicializar(graph.num_vertices);
+            tabu_.assign(graph.num_vertices, 0);
+            fila_uno_tight_.assign(graph.palabras_por_fila, 0);
+        }
+        candidatos_.limpiar();
+    }
+
+    Perturbation perturbacion(const Solution& s, int v) const {
+        Perturbation p;
+        p.vertex = v;
+        p.global_cost = -(s.size + 1 - s.tightness[v]);
+        return p;
+    }
+
+    // Elige un libre al azar (uniforme) hasta que no quede ninguno.
+    void agregar_libres(Solution& s, std::mt19937_64& generator) {
+        for (int libres = s.libres.contar(); libres > 0; libres = s.libres.contar()) {
+            int k = std::uniform_int_distribution<int>(0, libres - 1)(generator);
+            std::size_t i = 0;
+            for (;; ++i) {
+                int c = __builtin_popcountll(s.libres.palabra(i));
+                if (k < c) break;
+                k -= c;
+            }
+            std::uint64_t b = s.libres.palabra(i);
+            for (; k > 0; --k) b &= b - 1;
+            int v = (int)(i * 64 + __builtin_ctzll(b));
+            agregar(s, v);
+            candidatos_.agregar(v);
+        }
+    }
+
+    // Primer w en fila_uno_tight_ distinto de u y no adyacente a u:
+    // fila_uno_tight_ AND NOT fila(u), palabra a palabra.
+    int companero_no_adyacente(int u) const {
+        const std::uint64_t* fila = graph.fila(u);
+        for (std::size_t i = 0; i < graph.palabras_por_fila; ++i) {
+            std::uint64_t b = fila_uno_tight_[i] & ~fila[i];
+            if ((std::size_t)(u >> 6) == i) b &= ~((std::uint64_t)1 << (u & 63));
+            if (b != 0) return (int)(i * 64 + __builtin_ctzll(b));
+        }
+        return -1;
+    }
+
+    void mejoras_2(Solution& s, std::mt19937_64& generator) {
+        const std::size_t w = graph.palabras_por_fila;
+        while (!candidatos_.empty()) {
+            std::uniform_int_distribution<int> dist(0, candidatos_.size() - 1);
+            int x = candidatos_[dist(generator)];
+            candidatos_.quitar(x);
+            if (!s.in_set[x] || tabu_[x]) continue;
+
+            const std::uint64_t* fila = graph.fila(x);
+            uno_tight_.clear();
+            for (std::size_t i = 0; i < w; ++i) {
+                fila_uno_tight_[i] = fila[i] & s.uno_tight.palabra(i);
+                for (std::uint64_t b = fila_uno_tight_[i]; b != 0; b &= b - 1)
+                    uno_tight_.push_back((int)(i * 64 + __builtin_ctzll(b)));
+            }
+            if (uno_tight_.size() < 2) continue;
+
+            int u = -1, v = -1;
+            int k = (int)uno_tight_.size();
+            int inicio = std::uniform_int_distribution<int>(0, k - 1)(generator);
+            for (int i = 0; i < k && v == -1; ++i) {
+                u = uno_tight_[(inicio + i) % k];
+                v = companero_no_adyacente(u);
+            }
+            if (v == -1) continue;
+
+            quitar(s, x);
+            agregar(s, u);
+            agregar(s, v);
+            agregar_libres(s, generator);
+            // Cualquier vertice de la solucion pudo ganar vecinos 1-tight.
+            for (int y : s.vertices) candidatos_.agregar(y);
+        }
+    }
+};
+
+inline std::string to_string(const EsquemaMISDenso&, const int& cost) { return std::to_string(-cost); }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "InstanciaMIS.hpp"
+#include "ConjuntoBits.hpp"
+
+// Grafo denso: la vecindad de cada vertice es una fila de bits de n bits
+// (n * n / 8 bytes en total). Adyacencia en O(1) y operaciones sobre
+// vecindades completas palabra a palabra.
+struct GrafoDenso {
+    int num_vertices = 0;
+    std::size_t palabras_por_fila = 0;
+    std::vector<std::uint64_t> filas;
+    std::vector<int> grados;
+
+    explicit GrafoDenso(const Graph& g)
+        : num_vertices(g.n()),
+          palabras_por_fila(((std::size_t)g.n() + 63) / 64),
+          filas((std::size_t)g.n() * (((std::size_t)g.n() + 63) / 64), 0),
+          grados(g.n()) {
+        for (int v = 0; v < num_vertices; ++v) {
+            std::uint64_t* f = filas.data() + (std::size_t)v * palabras_por_fila;
+            for (int u : g.vecinos(v))
+                f[u >> 6] |= (std::uint64_t)1 << (u & 63);
+            grados[v] = g.grado(v);
+        }
+    }
+
+    const std::uint64_t* fila(int v) const { return filas.data() + (std::size_t)v * palabras_por_fila; }
+
+    bool son_adyacentes(int u, int v) const { return (fila(u)[v >> 6] >> (v & 63)) & 1; }
+
+    int grado(int v) const { return grados[v]; }
+    int n() const { return num_vertices; }
+};
+
+// Se usa la representacion densa si la densidad es al menos 'densidad_minima'
+// y la matriz de bits ocupa a lo mas 'bytes_maximos'.
+inline bool conviene_denso(const Graph& g, double densidad_minima = 0.1,
+                           std::size_t bytes_maximos = (std::size_t)512 << 20) {
+    if (g.n() < 2) return false;
+    double n = g.n();
+    double densidad = 2.0 * (double)g.m() / (n * (n - 1));
+    std::size_t bytes = (std::size_t)g.n() * (((std::size_t)g.n() + 63) / 64) * 8;
+    return densidad >= densidad_minima && bytes <= bytes_maximos;
+}
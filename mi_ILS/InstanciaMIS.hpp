@@ -4,34 +4,158 @@
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
-
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include "LectorGrafo.hpp"
+#include "ConjuntoBits.hpp"
+
+// Grafo en formato CSR (compressed sparse row): los vecinos de v son
+// vecinos_[offsets[v]] .. vecinos_[offsets[v + 1] - 1], ordenados y sin
+// repetidos ni lazos.
 struct Graph {
-    int num_vertices;
-    std::vector<std::vector<int>> adj_list;
-
-    Graph(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open())
-            throw std::runtime_error("No se pudo abrir el archivo: " + filename);
-
-        file >> num_vertices;
-        adj_list.assign(num_vertices, {});
-
-        int u, v;
-        while (file >> u >> v) {
-            if (u >= num_vertices || v >= num_vertices || u < 0 || v < 0) continue;
-            adj_list[u].push_back(v);
-            adj_list[v].push_back(u);
-        }
+    // Rango de vecinos de un vertice (vista sobre el arreglo CSR).
+    struct Vecindad {
+        const int* inicio;
+        const int* fin;
+
+        const int* begin() const { return inicio; }
+        const int* end() const { return fin; }
+        int size() const { return (int)(fin - inicio); }
+        bool empty() const { return inicio == fin; }
+        int operator[](int i) const { return inicio[i]; }
+    };
+
+    int num_vertices = 0;
+    std::vector<std::size_t> offsets;
+    std::vector<int> vecinos_;
+
+    // Carga el grafo desde "<filename>.csr" si existe y esta al dia; si no,
+    // parsea el texto en paralelo y deja el cache escrito para la proxima vez.
+    Graph(const std::string& filename, bool usar_cache = true) {
+        if (usar_cache && leer_cache_csr(filename, num_vertices, offsets, vecinos_))
+            return;
+        std::vector<std::pair<int, int>> aristas;
+        leer_lista_aristas(filename, num_vertices, aristas);
+        construir(aristas);
+        if (usar_cache)
+            escribir_cache_csr(filename, num_vertices, offsets, vecinos_);
+    }
+
+    Graph(int n, const std::vector<std::pair<int, int>>& aristas) : num_vertices(n) {
+        construir(aristas);
+    }
+
+    Vecindad vecinos(int v) const {
+        return {vecinos_.data() + offsets[v], vecinos_.data() + offsets[v + 1]};
     }
 
+    int grado(int v) const { return (int)(offsets[v + 1] - offsets[v]); }
+
+    // Busqueda binaria en la lista mas corta: O(log min(d(u), d(v))).
     bool son_adyacentes(int u, int v) const {
-        for (int x : adj_list[u])
-            if (x == v) return true;
-        return false;
+        if (grado(u) > grado(v)) std::swap(u, v);
+        Vecindad vec = vecinos(u);
+        return std::binary_search(vec.begin(), vec.end(), v);
     }
 
     int n() const { return num_vertices; }
+    std::size_t m() const { return vecinos_.size() / 2; }
+
+private:
+    // Construye el CSR a partir de una lista de aristas no dirigidas;
+    // descarta lazos y aristas repetidas.
+    void construir(const std::vector<std::pair<int, int>>& aristas) {
+        offsets.assign(num_vertices + 1, 0);
+        for (const auto& a : aristas) {
+            if (a.first == a.second) continue;
+            offsets[a.first + 1]++;
+            offsets[a.second + 1]++;
+        }
+        for (int v = 0; v < num_vertices; ++v)
+            offsets[v + 1] += offsets[v];
+
+        vecinos_.resize(offsets[num_vertices]);
+        std::vector<std::size_t> pos(offsets.begin(), offsets.end() - 1);
+        for (const auto& a : aristas) {
+            if (a.first == a.second) continue;
+            vecinos_[pos[a.first]++] = a.second;
+            vecinos_[pos[a.second]++] = a.first;
+        }
+
+        // Ordenar y deduplicar cada lista (en paralelo por bloques de
+        // vertices) y luego compactar el arreglo.
+        std::vector<int> grados(num_vertices);
+        auto ordenar = [this, &grados](int desde, int hasta) {
+            for (int v = desde; v < hasta; ++v) {
+                auto ini = vecinos_.begin() + offsets[v];
+                auto fin = vecinos_.begin() + offsets[v + 1];
+                std::sort(ini, fin);
+                grados[v] = (int)(std::unique(ini, fin) - ini);
+            }
+        };
+        unsigned hilos = (vecinos_.size() < ((std::size_t)1 << 20)) ? 1 : numero_de_hilos();
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < hilos; ++t)
+            threads.emplace_back(ordenar,
+                                 (int)((long long)num_vertices * t / hilos),
+                                 (int)((long long)num_vertices * (t + 1) / hilos));
+        ordenar(0, (int)((long long)num_vertices / hilos));
+        for (auto& th : threads) th.join();
+
+        std::size_t escritura = 0;
+        for (int v = 0; v < num_vertices; ++v) {
+            std::size_t lectura = offsets[v];
+            offsets[v] = escritura;
+            for (int i = 0; i < grados[v]; ++i)
+                vecinos_[escritura++] = vecinos_[lectura + i];
+        }
+        offsets[num_vertices] = escritura;
+        vecinos_.resize(escritura);
+        vecinos_.shrink_to_fit();
+    }
+};
+
+// Conjunto de enteros en [0, n) con insercion, borrado y pertenencia en O(1)
+// (arreglo denso de elementos + posicion de cada elemento).
+struct ConjuntoIndexado {
+    std::vector<int> elementos;
+    std::vector<int> posicion; // -1 si no pertenece
+
+    void inicializar(int n) {
+        elementos.clear();
+        elementos.reserve(n);
+        posicion.assign(n, -1);
+    }
+
+    // Vacia el conjunto en O(size) (no O(n)).
+    void limpiar() {
+        for (int x : elementos) posicion[x] = -1;
+        elementos.clear();
+    }
+
+    bool contiene(int x) const { return posicion[x] != -1; }
+    int size() const { return (int)elementos.size(); }
+    bool empty() const { return elementos.empty(); }
+    int operator[](int i) const { return elementos[i]; }
+    std::vector<int>::const_iterator begin() const { return elementos.begin(); }
+    std::vector<int>::const_iterator end() const { return elementos.end(); }
+
+    void agregar(int x) {
+        if (posicion[x] != -1) return;
+        posicion[x] = (int)elementos.size();
+        elementos.push_back(x);
+    }
+
+    void quitar(int x) {
+        int p = posicion[x];
+        if (p == -1) return;
+        int ultimo = elementos.back();
+        elementos[p] = ultimo;
+        posicion[ultimo] = p;
+        elementos.pop_back();
+        posicion[x] = -1;
+    }
 };
 
 struct InstanciaMIS {
@@ -39,40 +163,68 @@ struct InstanciaMIS {
 
     InstanciaMIS(const Graph& g) : graph(g) {}
 
+    // Ademas del conjunto, la solucion mantiene de forma incremental:
+    // - tightness[v]: cantidad de vecinos de v que estan en la solucion,
+    // - libres: vertices fuera de la solucion con tightness 0 (agregables),
+    // - vertices: los vertices de la solucion.
+    // agregar/quitar los actualizan en O(grado). El conjunto va empaquetado
+    // en palabras de 64 bits (copia, conteo y distancia por palabras).
     struct Solucion {
-        std::vector<bool> in_set;
+        ConjuntoBits in_set;
         int size = 0;
+        std::vector<int> tightness;
+        ConjuntoIndexado libres;
+        ConjuntoIndexado vertices;
 
         void inicializar(int n) {
-            in_set.assign(n, false);
+            in_set.inicializar(n);
             size = 0;
+            tightness.assign(n, 0);
+            libres.inicializar(n);
+            for (int v = 0; v < n; ++v)
+                libres.agregar(v);
+            vertices.inicializar(n);
         }
+
+        // Distancia de Hamming: vertices que estan en solo una de las dos.
+        int distancia(const Solucion& otra) const { return in_set.distancia(otra.in_set); }
     };
 
+    // Perturbacion: forzar 'vertex' (y, segun la fuerza, otros vertices de
+    // su bola de radio 2) dentro de la solucion, expulsando a sus vecinos.
+    // Los vertices forzados y expulsados quedan en el esquema que la aplica,
+    // no en la perturbacion, que no se modifica.
     struct Perturbacion {
         int vertex = -1;
-        bool add = false;
         int global_cost = 0;
     };
 
     bool puede_agregar(const Solucion& s, int v) const {
-        if (s.in_set[v]) return false;
-        for (int u : graph.adj_list[v])
-            if (s.in_set[u]) return false;
-        return true;
+        return !s.in_set[v] && s.tightness[v] == 0;
     }
 
     bool agregar(Solucion& s, int v) const {
         if (!puede_agregar(s, v)) return false;
-        s.in_set[v] = true;
+        s.in_set.poner(v);
         s.size++;
+        s.vertices.agregar(v);
+        s.libres.quitar(v);
+        for (int u : graph.vecinos(v))
+            if (s.tightness[u]++ == 0)
+                s.libres.quitar(u);
         return true;
     }
 
     bool quitar(Solucion& s, int v) const {
         if (!s.in_set[v]) return false;
-        s.in_set[v] = false;
+        s.in_set.quitar(v);
         s.size--;
+        s.vertices.quitar(v);
+        for (int u : graph.vecinos(v))
+            if (--s.tightness[u] == 0 && !s.in_set[u])
+                s.libres.agregar(u);
+        if (s.tightness[v] == 0)
+            s.libres.agregar(v);
         return true;
     }
 
@@ -81,11 +233,11 @@ struct InstanciaMIS {
     }
 
     bool es_valida(const Solucion& s) const {
-        for (int v = 0; v < graph.num_vertices; ++v) {
-            if (!s.in_set[v]) continue;
-            for (int u : graph.adj_list[v])
+        for (int v : s.vertices) {
+            if (!s.in_set[v]) return false;
+            for (int u : graph.vecinos(v))
                 if (s.in_set[u]) return false;
         }
-        return true;
+        return s.vertices.size() == s.size && s.in_set.contar() == s.size;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include "localsearchsolver/iterated_local_search.hpp"
+#include "InstanciaMIS.hpp"
+#include "EsquemaMIS.hpp"
+#include "EsquemaMISDenso.hpp"
+
+// ILS por islas: varios ILS independientes sobre el mismo grafo, cada uno en
+// su hilo, con su propio EsquemaMIS y semilla. Comparten el mejor conjunto a
+// traves de un IntercambioMIS; una isla estancada reinicia desde el mejor
+// global en vez de desde una nueva solucion GRASP.
+
+struct ParametrosIslas {
+    double tiempo_limite = 1.0;
+    localsearchsolver::Counter max_iteraciones = -1;
+    localsearchsolver::Counter min_perturbaciones = 1;
+    double alpha = 0.3;
+    int fuerza_perturbacion = 2;
+    unsigned islas = 1;
+    std::uint64_t semilla = 0;
+    int verbosity_level = 1;
+};
+
+// Devuelve el mejor conjunto encontrado por las islas; 'tiempo_al_mejor'
+// queda en segundos desde el inicio de la busqueda. Esquema es EsquemaMIS
+// (con Grafo = Graph) o EsquemaMISDenso (con Grafo = GrafoDenso).
+template <typename Esquema, typename Grafo>
+inline typename Esquema::Solution ils_por_islas(const Grafo& g, const ParametrosIslas& p, double& tiempo_al_mejor) {
+    const unsigned islas = std::max(1u, p.islas);
+    auto intercambio = std::make_shared<localsearchsolver::IntercambioMIS>(islas > 1);
+
+    std::vector<typename Esquema::Solution> mejores(islas);
+    auto isla = [&](unsigned k) {
+        Esquema esquema(g, intercambio);
+        esquema.alpha = p.alpha;
+        esquema.fuerza_perturbacion = p.fuerza_perturbacion;
+
+        localsearchsolver::IteratedLocalSearchParameters<Esquema> params;
+        params.timer.set_time_limit(std::max(p.tiempo_limite, 0.0));
+        params.maximum_number_of_iterations = p.max_iteraciones;
+        params.minimum_number_of_perturbations = p.min_perturbaciones;
+        params.seed = p.semilla + k;
+        // Con varias islas las salidas se mezclarian.
+        params.verbosity_level = (islas == 1) ? p.verbosity_level : 0;
+        params.new_solution_callback = [&esquema](const localsearchsolver::Output<Esquema>& output) {
+            esquema.registrar_mejora(output.solution_pool.best());
+        };
+
+        auto output = localsearchsolver::iterated_local_search(esquema, params);
+        mejores[k] = output.solution_pool.best();
+        if (output.solution_pool.size() == 0) {
+            // Sin tiempo: al menos una solucion GRASP + busqueda local.
+            std::mt19937_64 generator(params.seed);
+            mejores[k] = esquema.initial_solution(0, generator);
+            esquema.local_search(mejores[k], generator);
+            esquema.registrar_mejora(mejores[k]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned k = 1; k < islas; ++k)
+        threads.emplace_back(isla, k);
+    isla(0);
+    for (auto& th : threads) th.join();
+
+    tiempo_al_mejor = intercambio->tiempo_al_mejor();
+    unsigned mejor = 0;
+    for (unsigned k = 1; k < islas; ++k)
+        if (mejores[k].size > mejores[mejor].size) mejor = k;
+    return std::move(mejores[mejor]);
+}
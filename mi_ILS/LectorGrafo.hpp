@@ -0,0 +1,284 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MIS_USAR_MMAP 1
+#endif
+
+// Lectura rapida de grafos: archivo mapeado en memoria, parseo en paralelo
+// por bloques de lineas y un cache binario del CSR ("<archivo>.csr").
+
+// Archivo de solo lectura mapeado en memoria (o leido completo si no hay mmap).
+class ArchivoMapeado {
+public:
+    explicit ArchivoMapeado(const std::string& filename) {
+#ifdef MIS_USAR_MMAP
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            throw std::runtime_error("No se pudo abrir el archivo: " + filename);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("No se pudo leer el archivo: " + filename);
+        }
+        size_ = (std::size_t)st.st_size;
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd_);
+                throw std::runtime_error("No se pudo mapear el archivo: " + filename);
+            }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+#else
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("No se pudo abrir el archivo: " + filename);
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    ~ArchivoMapeado() {
+#ifdef MIS_USAR_MMAP
+        if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef MIS_USAR_MMAP
+    int fd_ = -1;
+#else
+    std::string buffer_;
+#endif
+};
+
+// Lee un entero (con signo) saltando blancos del resto de la linea.
+// Devuelve false si la linea termina antes de encontrar un numero.
+inline bool leer_entero_linea(const char*& p, const char* fin, long long& valor) {
+    while (p < fin && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    if (p >= fin || *p == '\n') return false;
+    bool negativo = false;
+    if (*p == '-' || *p == '+') {
+        negativo = (*p == '-');
+        ++p;
+    }
+    if (p >= fin || *p < '0' || *p > '9') return false;
+    long long x = 0;
+    while (p < fin && *p >= '0' && *p <= '9') {
+        x = x * 10 + (*p - '0');
+        ++p;
+    }
+    valor = negativo ? -x : x;
+    return true;
+}
+
+// Parsea las lineas "u v" de [inicio, fin); descarta ids fuera de rango.
+inline void parsear_bloque(const char* inicio, const char* fin, int num_vertices,
+                           std::vector<std::pair<int, int>>& aristas) {
+    const char* p = inicio;
+    while (p < fin) {
+        long long u, v;
+        if (leer_entero_linea(p, fin, u) && leer_entero_linea(p, fin, v)
+                && u >= 0 && v >= 0 && u < num_vertices && v < num_vertices)
+            aristas.push_back({(int)u, (int)v});
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', fin - p));
+        p = (nl == nullptr) ? fin : nl + 1;
+    }
+}
+
+inline unsigned numero_de_hilos() {
+    unsigned h = std::thread::hardware_concurrency();
+    return (h == 0) ? 1 : h;
+}
+
+// Lee "n" seguido de una arista "u v" por linea, repartiendo el archivo en
+// bloques (cortados en saltos de linea) entre los hilos disponibles.
+inline void leer_lista_aristas(const std::string& filename, int& num_vertices,
+                               std::vector<std::pair<int, int>>& aristas) {
+    ArchivoMapeado archivo(filename);
+    const char* p = archivo.data();
+    const char* fin = p + archivo.size();
+
+    while (p < fin && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+    long long n = 0;
+    if (!leer_entero_linea(p, fin, n) || n < 0)
+        throw std::runtime_error("Cabecera invalida en el archivo: " + filename);
+    num_vertices = (int)n;
+
+    unsigned hilos = numero_de_hilos();
+    std::size_t restante = fin - p;
+    if (restante < ((std::size_t)1 << 20)) hilos = 1;
+
+    std::vector<const char*> cortes(hilos + 1, fin);
+    cortes[0] = p;
+    for (unsigned t = 1; t < hilos; ++t) {
+        const char* c = p + restante * t / hilos;
+        if (c < cortes[t - 1]) c = cortes[t - 1];
+        const char* nl = static_cast<const char*>(std::memchr(c, '\n', fin - c));
+        cortes[t] = (nl == nullptr) ? fin : nl + 1;
+    }
+
+    std::vector<std::vector<std::pair<int, int>>> parciales(hilos);
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < hilos; ++t)
+        threads.emplace_back(parsear_bloque, cortes[t], cortes[t + 1], num_vertices, std::ref(parciales[t]));
+    parsear_bloque(cortes[0], cortes[1], num_vertices, parciales[0]);
+    for (auto& th : threads) th.join();
+
+    aristas = std::move(parciales[0]);
+    std::size_t total = aristas.size();
+    for (unsigned t = 1; t < hilos; ++t) total += parciales[t].size();
+    aristas.reserve(total);
+    for (unsigned t = 1; t < hilos; ++t) {
+        aristas.insert(aristas.end(), parciales[t].begin(), parciales[t].end());
+        std::vector<std::pair<int, int>>().swap(parciales[t]);
+    }
+}
+
+// --- Cache binario del CSR ---
+// Cabecera: firma, tamanio y fecha de modificacion del archivo de texto de
+// origen; si no coinciden el cache se considera obsoleto y se ignora.
+
+struct CabeceraCacheCSR {
+    char firma[8];
+    std::uint64_t bytes_origen;
+    std::int64_t mtime_origen;
+    std::uint32_t bytes_offset;
+    std::int32_t num_vertices;
+    std::uint64_t num_vecinos;
+};
+
+inline bool datos_archivo(const std::string& filename, std::uint64_t& bytes, std::int64_t& mtime) {
+#ifdef MIS_USAR_MMAP
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0) return false;
+    bytes = (std::uint64_t)st.st_size;
+    mtime = (std::int64_t)st.st_mtime;
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    bytes = (std::uint64_t)file.tellg();
+    mtime = 0;
+    return true;
+#endif
+}
+
+inline CabeceraCacheCSR cabecera_cache(const std::string& filename) {
+    CabeceraCacheCSR c;
+    std::memset(&c, 0, sizeof(c));
+    std::memcpy(c.firma, "MISCSR1", 8);
+    c.bytes_offset = (std::uint32_t)sizeof(std::size_t);
+    if (!datos_archivo(filename, c.bytes_origen, c.mtime_origen))
+        c.firma[0] = '\0';
+    return c;
+}
+
+// Comprueba en una pasada lineal que el CSR leido del cache es consistente: offsets
+// no decrecientes desde 0 hasta num_vecinos y vecinos en [0, n). Un cache
+// corrupto o de otra version provocaria accesos fuera de rango en vecinos(v).
+inline bool csr_valido(int num_vertices, const std::vector<std::size_t>& offsets,
+                       const std::vector<int>& vecinos) {
+    if (offsets.size() != (std::size_t)num_vertices + 1 || offsets[0] != 0
+            || offsets.back() != vecinos.size())
+        return false;
+    for (int v = 0; v < num_vertices; ++v)
+        if (offsets[v] > offsets[v + 1]) return false;
+    for (int u : vecinos)
+        if (u < 0 || u >= num_vertices) return false;
+    return true;
+}
+
+inline bool leer_cache_csr(const std::string& filename, int& num_vertices,
+                           std::vector<std::size_t>& offsets, std::vector<int>& vecinos) {
+    CabeceraCacheCSR esperada = cabecera_cache(filename);
+    if (esperada.firma[0] == '\0') return false;
+    std::ifstream file(filename + ".csr", std::ios::binary);
+    if (!file.is_open()) return false;
+
+    CabeceraCacheCSR c;
+    if (!file.read(reinterpret_cast<char*>(&c), sizeof(c))) return false;
+    if (std::memcmp(c.firma, esperada.firma, 8) != 0
+            || c.bytes_origen != esperada.bytes_origen
+            || c.mtime_origen != esperada.mtime_origen
+            || c.bytes_offset != esperada.bytes_offset
+            || c.num_vertices < 0)
+        return false;
+
+    // El tamanio del cache debe corresponder exactamente a la cabecera, antes
+    // de reservar memoria con valores que podrian estar corruptos.
+    file.seekg(0, std::ios::end);
+    std::uint64_t bytes_cache = (std::uint64_t)file.tellg();
+    if (!file || c.num_vecinos > bytes_cache
+            || bytes_cache != sizeof(c)
+                + ((std::uint64_t)c.num_vertices + 1) * sizeof(std::size_t)
+                + c.num_vecinos * sizeof(int))
+        return false;
+    file.seekg(sizeof(c), std::ios::beg);
+
+    offsets.resize((std::size_t)c.num_vertices + 1);
+    vecinos.resize(c.num_vecinos);
+    if (!file.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(std::size_t))
+            || !file.read(reinterpret_cast<char*>(vecinos.data()), vecinos.size() * sizeof(int))
+            || !csr_valido(c.num_vertices, offsets, vecinos)) {
+        offsets.clear();
+        vecinos.clear();
+        return false;
+    }
+    num_vertices = c.num_vertices;
+    return true;
+}
+
+// Escribe el cache de forma atomica (archivo temporal + rename). Los errores
+// se ignoran: el cache es solo una optimizacion.
+inline void escribir_cache_csr(const std::string& filename, int num_vertices,
+                               const std::vector<std::size_t>& offsets, const std::vector<int>& vecinos) {
+    CabeceraCacheCSR c = cabecera_cache(filename);
+    if (c.firma[0] == '\0') return;
+    c.num_vertices = num_vertices;
+    c.num_vecinos = vecinos.size();
+
+    std::string destino = filename + ".csr";
+    std::string temporal = destino + ".tmp";
+    {
+        std::ofstream file(temporal, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return;
+        file.write(reinterpret_cast<const char*>(&c), sizeof(c));
+        file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(std::size_t));
+        file.write(reinterpret_cast<const char*>(vecinos.data()), vecinos.size() * sizeof(int));
+        if (!file) {
+            file.close();
+            std::remove(temporal.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporal.c_str(), destino.c_str()) != 0)
+        std::remove(temporal.c_str());
+}
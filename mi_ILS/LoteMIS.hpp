@@ -0,0 +1,193 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <map>
+#include <chrono>
+#include <cstdint>
+#include "nlohmann/json.hpp"
+#include "InstanciaMIS.hpp"
+#include "ReduccionesMIS.hpp"
+#include "ComponentesMIS.hpp"
+
+// Modo lote: corre muchos experimentos (instancia x semilla x parametros)
+// dentro de un solo proceso. Cada grafo se lee y se kerneliza una sola vez y
+// los trabajos se reparten entre un pool de hilos, uno por trabajo.
+//
+// Manifiesto: una linea por grupo de experimentos; '#' inicia un comentario.
+//   <archivo> <tiempo> <semillas> <alpha> <fuerza> <pert>
+// Las cuatro ultimas columnas son listas separadas por comas y se corre el
+// producto cartesiano, p. ej.:
+//   grafos/g1.txt 10 1,2,3 0.1,0.3 2 1
+// El algoritmo y el limite de iteraciones se toman de la linea de comandos
+// y son los mismos para todos los trabajos.
+
+struct TrabajoLote {
+    std::string archivo;
+    double tiempo = 1.0;
+    std::uint64_t semilla = 0;
+    double alpha = 0.3;
+    int fuerza = 2;
+    localsearchsolver::Counter pert = 1;
+
+    // Resultado.
+    int tamanio = 0;
+    double tiempo_total = 0.0;
+    double tiempo_al_mejor = 0.0;
+};
+
+template <typename T>
+std::vector<T> leer_lista(const std::string& campo, T (*convertir)(const std::string&)) {
+    std::vector<T> valores;
+    std::stringstream ss(campo);
+    std::string valor;
+    while (std::getline(ss, valor, ','))
+        if (!valor.empty()) valores.push_back(convertir(valor));
+    if (valores.empty())
+        throw std::runtime_error("Lista vacia en el manifiesto: " + campo);
+    return valores;
+}
+
+inline std::vector<TrabajoLote> leer_manifiesto(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open())
+        throw std::runtime_error("No se pudo abrir el manifiesto: " + filename);
+
+    auto a_semilla = [](const std::string& s) -> std::uint64_t { return std::stoull(s); };
+    auto a_double = [](const std::string& s) -> double { return std::stod(s); };
+    auto a_int = [](const std::string& s) -> int { return std::stoi(s); };
+    auto a_counter = [](const std::string& s) -> localsearchsolver::Counter { return std::stoll(s); };
+
+    std::vector<TrabajoLote> trabajos;
+    std::string linea;
+    int numero_linea = 0;
+    while (std::getline(file, linea)) {
+        numero_linea++;
+        std::size_t comentario = linea.find('#');
+        if (comentario != std::string::npos) linea.erase(comentario);
+        std::stringstream ss(linea);
+        std::vector<std::string> campos;
+        std::string campo;
+        while (ss >> campo) campos.push_back(campo);
+        if (campos.empty()) continue;
+        if (campos.size() != 6)
+            throw std::runtime_error("Linea " + std::to_string(numero_linea)
+                                     + " del manifiesto: se esperaban 6 columnas.");
+
+        double tiempo = std::stod(campos[1]);
+        for (std::uint64_t semilla : leer_lista<std::uint64_t>(campos[2], a_semilla))
+        for (double alpha : leer_lista<double>(campos[3], a_double))
+        for (int fuerza : leer_lista<int>(campos[4], a_int))
+        for (localsearchsolver::Counter pert : leer_lista<localsearchsolver::Counter>(campos[5], a_counter)) {
+            TrabajoLote t;
+            t.archivo = campos[0];
+            t.tiempo = tiempo;
+            t.semilla = semilla;
+            t.alpha = alpha;
+            t.fuerza = fuerza;
+            t.pert = pert;
+            trabajos.push_back(t);
+        }
+    }
+    return trabajos;
+}
+
+// Grafo cargado una vez y compartido (solo lectura) por sus trabajos.
+struct GrafoLote {
+    std::unique_ptr<Graph> grafo;
+    std::unique_ptr<ReduccionesMIS> reducciones;
+
+    const Graph& busqueda() const { return (reducciones) ? reducciones->kernel() : *grafo; }
+};
+
+// 'base' aporta los parametros que no vienen del manifiesto (algoritmo,
+// iteraciones, tamanio exacto); el resto se toma de cada trabajo.
+inline void ejecutar_lote(std::vector<TrabajoLote>& trabajos, unsigned hilos,
+                          bool usar_cache, bool usar_reducciones,
+                          const ParametrosComponentes& base = ParametrosComponentes()) {
+    using reloj = std::chrono::high_resolution_clock;
+
+    std::map<std::string, GrafoLote> grafos;
+    for (const TrabajoLote& t : trabajos) {
+        if (grafos.count(t.archivo)) continue;
+        GrafoLote& g = grafos[t.archivo];
+        g.grafo.reset(new Graph(t.archivo, usar_cache));
+        if (usar_reducciones) g.reducciones.reset(new ReduccionesMIS(*g.grafo));
+    }
+
+    std::atomic<std::size_t> siguiente(0);
+    auto trabajador = [&]() {
+        for (;;) {
+            std::size_t i = siguiente.fetch_add(1);
+            if (i >= trabajos.size()) return;
+            TrabajoLote& t = trabajos[i];
+            const GrafoLote& g = grafos.at(t.archivo);
+            auto inicio = reloj::now();
+
+            ParametrosComponentes params = base;
+            params.tiempo_limite = t.tiempo;
+            params.min_perturbaciones = t.pert;
+            params.alpha = t.alpha;
+            params.fuerza_perturbacion = t.fuerza;
+            params.hilos = 1;
+            params.semilla = t.semilla;
+            params.verbosity_level = 0;
+
+            ResultadoComponentes resultado = resolver_por_componentes(g.busqueda(), params);
+            t.tamanio = (g.reducciones) ? g.reducciones->levantar(resultado.solucion).size
+                                        : resultado.solucion.size;
+            t.tiempo_total = std::chrono::duration<double>(reloj::now() - inicio).count();
+            t.tiempo_al_mejor = resultado.tiempo_al_mejor;
+        }
+    };
+
+    hilos = std::max(1u, std::min(hilos, (unsigned)trabajos.size()));
+    std::vector<std::thread> threads;
+    for (unsigned k = 1; k < hilos; ++k)
+        threads.emplace_back(trabajador);
+    trabajador();
+    for (auto& th : threads) th.join();
+}
+
+// Campo de CSV: entre comillas (y con las comillas duplicadas) si contiene
+// comas, comillas o saltos de linea.
+inline std::string campo_csv(const std::string& campo) {
+    if (campo.find_first_of(",\"\r\n") == std::string::npos) return campo;
+    std::string escapado = "\"";
+    for (char c : campo) {
+        if (c == '"') escapado += '"';
+        escapado += c;
+    }
+    escapado += '"';
+    return escapado;
+}
+
+// Escribe la tabla de resultados, un trabajo por fila, en JSON o CSV.
+inline void escribir_resultados_lote(const std::vector<TrabajoLote>& trabajos, std::ostream& os, bool json) {
+    if (json) {
+        nlohmann::json tabla = nlohmann::json::array();
+        for (const TrabajoLote& t : trabajos) {
+            tabla.push_back({
+                {"instancia", t.archivo},
+                {"semilla", t.semilla},
+                {"alpha", t.alpha},
+                {"fuerza", t.fuerza},
+                {"pert", t.pert},
+                {"tamanio", t.tamanio},
+                {"tiempo_total", t.tiempo_total},
+                {"tiempo_al_mejor", t.tiempo_al_mejor}});
+        }
+        os << tabla.dump(2) << std::endl;
+        return;
+    }
+    os << "instancia,semilla,alpha,fuerza,pert,tamanio,tiempo_total,tiempo_al_mejor\n";
+    for (const TrabajoLote& t : trabajos) {
+        os << campo_csv(t.archivo) << "," << t.semilla << "," << t.alpha << "," << t.fuerza << ","
+           << t.pert << "," << t.tamanio << "," << t.tiempo_total << "," << t.tiempo_al_mejor << "\n";
+    }
+}
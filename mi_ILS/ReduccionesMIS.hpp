@@ -0,0 +1,310 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "InstanciaMIS.hpp"
+
+// Reducciones exactas para MIS aplicadas antes de la busqueda:
+// - grado 0 y grado 1: el vertice entra a la solucion,
+// - grado 2: si sus vecinos son adyacentes entra; si no, se pliega
+//   (v, u, w) en un solo vertice y alpha(G) = alpha(G') + 1,
+// - dominancia: si N[v] esta contenido en N[u], u puede descartarse,
+// - gemelos de grado 3 (N(u) = N(v)): si N(u) tiene una arista, u y v
+//   entran; si no, se pliegan u, v y N(u) y alpha(G) = alpha(G') + 2.
+// El resultado es un grafo kernel (con ids 0..k-1) y una pila de operaciones
+// para levantar una solucion del kernel a una del grafo original.
+//
+// Referencias:
+// "Finding near-optimal independent sets at scale" (Lamm et al., 2017)
+// "Confining sets and avoiding bottleneck cases: A simple maximum independent
+// set algorithm in degree-3 graphs" (Xiao y Nagamochi, 2013)
+class ReduccionesMIS {
+public:
+    // La dominancia solo se prueba desde vertices de grado <= limite_dominancia
+    // para que su costo no dependa de los vertices de grado alto.
+    explicit ReduccionesMIS(const Graph& g, int limite_dominancia = 32)
+        : original_(g), limite_dominancia_(limite_dominancia) {
+        const int n = g.n();
+        adj_.resize(n);
+        grado_.resize(n);
+        vivo_.assign(n, 1);
+        en_cola_.assign(n, 1);
+        for (int v = 0; v < n; ++v) {
+            Graph::Vecindad vec = g.vecinos(v);
+            adj_[v].assign(vec.begin(), vec.end());
+            grado_[v] = vec.size();
+        }
+        for (int v = n - 1; v >= 0; --v) cola_.push_back(v);
+
+        while (!cola_.empty()) {
+            int v = cola_.back();
+            cola_.pop_back();
+            en_cola_[v] = 0;
+            if (vivo_[v]) reducir(v);
+        }
+        construir_kernel();
+    }
+
+    const Graph& kernel() const { return *kernel_; }
+
+    // Vertices que las reducciones ya garantizan en la solucion.
+    int tamanio_fijo() const { return tamanio_fijo_; }
+
+    int vertice_original(int k) const { return original_de_[k]; }
+
+    // Levanta una solucion del kernel a una solucion del grafo original,
+    // deshaciendo las reducciones en orden inverso.
+    InstanciaMIS::Solucion levantar(const InstanciaMIS::Solucion& s_kernel) const {
+        std::vector<char> en_solucion(original_.n(), 0);
+        for (int k : s_kernel.vertices)
+            en_solucion[original_de_[k]] = 1;
+        for (auto it = pila_.rbegin(); it != pila_.rend(); ++it) {
+            if (it->tipo == Operacion::Incluir) {
+                en_solucion[it->vertice] = 1;
+                continue;
+            }
+            bool tomado = en_solucion[it->vertice];
+            en_solucion[it->vertice] = 0;
+            if (tomado) {
+                for (int i = 0; i < it->num_plegados; ++i) en_solucion[it->plegados[i]] = 1;
+            } else {
+                for (int i = 0; i < it->num_alternativas; ++i) en_solucion[it->alternativas[i]] = 1;
+            }
+        }
+
+        InstanciaMIS instancia(original_);
+        InstanciaMIS::Solucion s;
+        s.inicializar(original_.n());
+        for (int v = 0; v < original_.n(); ++v)
+            if (en_solucion[v] && !instancia.agregar(s, v))
+                throw std::runtime_error("La solucion levantada del kernel no es independiente.");
+        return s;
+    }
+
+    // --- Estadisticas ---
+    int reducidos_grado_0_1 = 0;
+    int reducidos_grado_2 = 0;
+    int plegados_grado_2 = 0;
+    int dominados = 0;
+    int gemelos = 0;
+
+private:
+    struct Operacion {
+        enum Tipo { Incluir, Plegar };
+        Tipo tipo;
+        // Incluir: vertice que entra. Plegar: vertice que representa al
+        // plegado en el grafo reducido.
+        int vertice;
+        // Si el vertice plegado queda en la solucion entran 'plegados'; si
+        // no, entran 'alternativas'.
+        int plegados[3];
+        int num_plegados;
+        int alternativas[2];
+        int num_alternativas;
+    };
+
+    const Graph& original_;
+    int limite_dominancia_;
+
+    // Grafo de trabajo: listas ordenadas; las entradas de vertices muertos se
+    // ignoran (borrado perezoso).
+    std::vector<std::vector<int>> adj_;
+    std::vector<int> grado_;
+    std::vector<char> vivo_;
+    std::vector<char> en_cola_;
+    std::vector<int> cola_;
+    std::vector<Operacion> pila_;
+    int tamanio_fijo_ = 0;
+
+    std::unique_ptr<Graph> kernel_;
+    std::vector<int> original_de_;
+
+    void encolar(int v) {
+        if (en_cola_[v] || !vivo_[v]) return;
+        en_cola_[v] = 1;
+        cola_.push_back(v);
+    }
+
+    bool adyacentes(int a, int b) const {
+        const std::vector<int>& l = (adj_[a].size() <= adj_[b].size()) ? adj_[a] : adj_[b];
+        int x = (adj_[a].size() <= adj_[b].size()) ? b : a;
+        return vivo_[a] && vivo_[b] && std::binary_search(l.begin(), l.end(), x);
+    }
+
+    void vecinos_vivos(int v, std::vector<int>& out) const {
+        out.clear();
+        for (int u : adj_[v])
+            if (vivo_[u]) out.push_back(u);
+    }
+
+    void matar(int x) {
+        vivo_[x] = 0;
+        for (int y : adj_[x]) {
+            if (!vivo_[y]) continue;
+            grado_[y]--;
+            encolar(y);
+        }
+    }
+
+    void incluir(int v) {
+        Operacion op;
+        op.tipo = Operacion::Incluir;
+        op.vertice = v;
+        op.num_plegados = op.num_alternativas = 0;
+        pila_.push_back(op);
+        tamanio_fijo_++;
+        vecinos_vivos(v, aux_);
+        matar(v);
+        for (int u : aux_) matar(u);
+    }
+
+    // Reemplaza a los vertices 'grupo' (independientes entre si) por
+    // 'nuevo', adyacente a la union de sus vecindades salvo 'excluidos'.
+    void plegar(int nuevo, const std::vector<int>& grupo, const std::vector<int>& excluidos) {
+        std::vector<int> unido;
+        for (int g : grupo)
+            for (int x : adj_[g])
+                if (vivo_[x] && x != nuevo
+                        && std::find(excluidos.begin(), excluidos.end(), x) == excluidos.end())
+                    unido.push_back(x);
+        std::sort(unido.begin(), unido.end());
+        unido.erase(std::unique(unido.begin(), unido.end()), unido.end());
+
+        for (int x : excluidos) vivo_[x] = 0;
+        for (int g : grupo) if (g != nuevo) vivo_[g] = 0;
+
+        for (int x : unido) {
+            std::vector<int>& l = adj_[x];
+            int perdidos = 0;
+            for (int g : grupo)
+                if (std::binary_search(l.begin(), l.end(), g)) perdidos++;
+            auto it = std::lower_bound(l.begin(), l.end(), nuevo);
+            if (it == l.end() || *it != nuevo) l.insert(it, nuevo);
+            grado_[x] += 1 - perdidos;
+            encolar(x);
+        }
+        for (int x : excluidos) std::vector<int>().swap(adj_[x]);
+        for (int g : grupo) if (g != nuevo) std::vector<int>().swap(adj_[g]);
+        grado_[nuevo] = (int)unido.size();
+        adj_[nuevo] = std::move(unido);
+        encolar(nuevo);
+    }
+
+    void reducir(int v) {
+        int d = grado_[v];
+        if (d <= 1) {
+            reducidos_grado_0_1++;
+            incluir(v);
+            return;
+        }
+        if (d == 2) {
+            vecinos_vivos(v, aux_);
+            int u = aux_[0], w = aux_[1];
+            if (adyacentes(u, w)) {
+                reducidos_grado_2++;
+                incluir(v);
+                return;
+            }
+            plegados_grado_2++;
+            Operacion op;
+            op.tipo = Operacion::Plegar;
+            op.vertice = v;
+            op.plegados[0] = u;
+            op.plegados[1] = w;
+            op.num_plegados = 2;
+            op.alternativas[0] = v;
+            op.num_alternativas = 1;
+            pila_.push_back(op);
+            tamanio_fijo_++;
+            // v pasa a representar al plegado {u, w}.
+            plegar(v, {u, w}, {});
+            return;
+        }
+        if (d == 3 && gemelo(v)) return;
+        if (d <= limite_dominancia_) dominancia(v);
+    }
+
+    // Descarta un vecino u de v con N[v] contenido en N[u].
+    void dominancia(int v) {
+        vecinos_vivos(v, aux_);
+        for (int u : aux_) {
+            if (grado_[u] < grado_[v]) continue;
+            bool domina = true;
+            for (int x : aux_) {
+                if (x != u && !adyacentes(u, x)) {
+                    domina = false;
+                    break;
+                }
+            }
+            if (domina) {
+                dominados++;
+                matar(u);
+                encolar(v);
+                return;
+            }
+        }
+    }
+
+    bool gemelo(int v) {
+        std::vector<int> nv;
+        vecinos_vivos(v, nv);
+        int menor = nv[0];
+        for (int a : nv)
+            if (grado_[a] < grado_[menor]) menor = a;
+
+        int t = -1;
+        for (int y : adj_[menor]) {
+            if (y == v || !vivo_[y] || grado_[y] != 3) continue;
+            vecinos_vivos(y, aux_);
+            if (aux_ == nv) {
+                t = y;
+                break;
+            }
+        }
+        if (t == -1) return false;
+
+        gemelos++;
+        int a = nv[0], b = nv[1], c = nv[2];
+        if (adyacentes(a, b) || adyacentes(a, c) || adyacentes(b, c)) {
+            incluir(v);
+            incluir(t);
+            return true;
+        }
+        Operacion op;
+        op.tipo = Operacion::Plegar;
+        op.vertice = a;
+        op.plegados[0] = a;
+        op.plegados[1] = b;
+        op.plegados[2] = c;
+        op.num_plegados = 3;
+        op.alternativas[0] = v;
+        op.alternativas[1] = t;
+        op.num_alternativas = 2;
+        pila_.push_back(op);
+        tamanio_fijo_ += 2;
+        // a pasa a representar al plegado {a, b, c}.
+        plegar(a, {a, b, c}, {v, t});
+        return true;
+    }
+
+    void construir_kernel() {
+        const int n = original_.n();
+        std::vector<int> kernel_de(n, -1);
+        for (int v = 0; v < n; ++v) {
+            if (!vivo_[v]) continue;
+            kernel_de[v] = (int)original_de_.size();
+            original_de_.push_back(v);
+        }
+        std::vector<std::pair<int, int>> aristas;
+        for (int v : original_de_)
+            for (int x : adj_[v])
+                if (x > v && vivo_[x])
+                    aristas.push_back({kernel_de[v], kernel_de[x]});
+        std::vector<std::vector<int>>().swap(adj_);
+        kernel_.reset(new Graph((int)original_de_.size(), aristas));
+    }
+
+    std::vector<int> aux_;
+};
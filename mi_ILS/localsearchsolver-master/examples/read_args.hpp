@@ -8,6 +8,15 @@
 
 #include <boost/program_options.hpp>
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+
 namespace localsearchsolver
 {
 
@@ -25,6 +34,8 @@ boost::program_options::options_description setup_args()
         ("time-limit,t", boost::program_options::value<double>(), "Time limit in seconds\n  ex: 3600")
         ("goal,g", boost::program_options::value<double>(), "set goal")
         ("only-write-at-the-end,e", "Only write output and certificate files at the end")
+        ("trajectory", boost::program_options::value<std::string>(), "set trajectory path (one JSON line per new best solution)")
+        ("maximum-number-of-intermediary-outputs", boost::program_options::value<Counter>(), "set maximum number of intermediary outputs kept in the JSON output")
         ("verbosity-level,v", boost::program_options::value<int>(), "set verbosity level")
         ("print-checker", boost::program_options::value<int>()->default_value(1), "print checker")
         ("seed,s", boost::program_options::value<Seed>(), "")
@@ -37,12 +48,227 @@ boost::program_options::options_description setup_args()
         ("number-of-threads-1", boost::program_options::value<Seed>(), "")
         ("number-of-threads-2", boost::program_options::value<Seed>(), "")
         ("maximum-size-of-the-population", boost::program_options::value<Counter>(), "")
+        ("fingerprint-history", boost::program_options::value<bool>(), "store only 128-bit fingerprints of the visited solutions (best first)")
+        ("maximum-history-memory", boost::program_options::value<Counter>(), "set maximum memory of the fingerprint history, in bytes (best first)")
+        ("history-bloom-filter", boost::program_options::value<bool>(), "check a Bloom filter before the fingerprint history (best first)")
+        ("delta-encoded-nodes", boost::program_options::value<bool>(), "store nodes as deltas from their parent (best first, with --fingerprint-history)")
+        ("maximum-delta-chain-length", boost::program_options::value<Counter>(), "set maximum number of deltas between a node and a stored solution (best first)")
+        ("maximum-size-of-the-node-cache", boost::program_options::value<Counter>(), "set maximum number of solutions of expanded nodes kept in memory (best first)")
+        ("maximum-number-of-children-per-window", boost::program_options::value<Counter>(), "set maximum number of children of a node sorted at once (best first)")
+        ("maximum-number-of-cached-children", boost::program_options::value<Counter>(), "set maximum number of children kept in each node beyond the current window (best first)")
 
         ("reverse", boost::program_options::value<bool>(), "")
         ;
     return desc;
 }
 
+/**
+ * Writer of the JSON output and of the certificate of the best solution,
+ * running in a background thread so that the search never waits for the
+ * disk.
+ *
+ * The search only submits the intermediary output of each new best solution
+ * (Output::to_json()) and the best solution. The writer thread appends the
+ * intermediary outputs to its own copy of the JSON document, keeping at most
+ * 'maximum_number_of_intermediary_outputs' of them, and writes the document
+ * and the latest best solution. Submissions arriving while a write is in
+ * progress are batched into the next write. Each file is written to a
+ * temporary path and then renamed, so it is always complete; failures are
+ * reported on std::cerr.
+ */
+template <typename LocalScheme>
+class AsyncOutputWriter
+{
+    using Solution = typename LocalScheme::Solution;
+
+public:
+
+    /** Constructor. */
+    AsyncOutputWriter(
+            const LocalScheme& local_scheme,
+            const std::string& json_output_path,
+            const std::string& certificate_path,
+            Counter maximum_number_of_intermediary_outputs):
+        local_scheme_(local_scheme),
+        json_output_path_(json_output_path),
+        certificate_path_(certificate_path),
+        maximum_number_of_intermediary_outputs_(maximum_number_of_intermediary_outputs),
+        thread_(&AsyncOutputWriter::run, this) { }
+
+    /** Destructor; writes the last submitted state. */
+    ~AsyncOutputWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    /** Submit the current state of the output. */
+    void submit(const Output<LocalScheme>& output)
+    {
+        nlohmann::json intermediary_output = output.to_json();
+        std::unique_ptr<Solution> solution(new Solution(output.solution_pool.best()));
+        // The rest of the document (parameters) doesn't change during the
+        // search; it is copied once.
+        std::unique_ptr<nlohmann::json> document;
+        if (!has_document_) {
+            document.reset(new nlohmann::json(nlohmann::json::object()));
+            for (auto it = output.json.begin(); it != output.json.end(); ++it)
+                if (it.key() != "IntermediaryOutputs")
+                    (*document)[it.key()] = it.value();
+            has_document_ = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (document != nullptr)
+                pending_document_ = std::move(document);
+            pending_intermediary_outputs_.push_back(std::move(intermediary_output));
+            pending_solution_ = std::move(solution);
+        }
+        cv_.notify_all();
+    }
+
+    /** Wait until the last submitted state has been written. */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return pending_solution_ == nullptr && !writing_; });
+    }
+
+private:
+
+    void run()
+    {
+        for (;;) {
+            std::unique_ptr<nlohmann::json> document;
+            std::vector<nlohmann::json> intermediary_outputs;
+            std::unique_ptr<Solution> solution;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stop_ || pending_solution_ != nullptr; });
+                if (pending_solution_ == nullptr)
+                    return;
+                document = std::move(pending_document_);
+                intermediary_outputs.swap(pending_intermediary_outputs_);
+                solution = std::move(pending_solution_);
+                writing_ = true;
+            }
+            if (document != nullptr)
+                document_ = std::move(*document);
+            for (nlohmann::json& intermediary_output: intermediary_outputs) {
+                intermediary_outputs_.push_back(std::move(intermediary_output));
+                if (maximum_number_of_intermediary_outputs_ >= 0
+                        && (Counter)intermediary_outputs_.size()
+                        > maximum_number_of_intermediary_outputs_) {
+                    intermediary_outputs_.pop_front();
+                }
+            }
+            write(*solution);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                writing_ = false;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    /** Rename 'tmp_path' to 'path', reporting failures. */
+    static void rename(
+            const std::string& tmp_path,
+            const std::string& path)
+    {
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::cerr << "Unable to rename file \"" << tmp_path
+                << "\" to \"" << path << "\"." << std::endl;
+            std::remove(tmp_path.c_str());
+        }
+    }
+
+    void write(const Solution& solution) const
+    {
+        if (!json_output_path_.empty()) {
+            nlohmann::json json = document_;
+            json["IntermediaryOutputs"] = nlohmann::json::array();
+            for (const nlohmann::json& intermediary_output: intermediary_outputs_)
+                json["IntermediaryOutputs"].push_back(intermediary_output);
+            std::string tmp_path = json_output_path_ + ".tmp";
+            bool ok = false;
+            {
+                std::ofstream file(tmp_path);
+                if (file.good()) {
+                    file << json.dump(4);
+                    file.close();
+                    ok = !file.fail();
+                }
+            }
+            if (ok) {
+                rename(tmp_path, json_output_path_);
+            } else {
+                std::cerr << "Unable to write file \"" << tmp_path << "\"." << std::endl;
+                std::remove(tmp_path.c_str());
+            }
+        }
+        if (!certificate_path_.empty()) {
+            std::string tmp_path = certificate_path_ + ".tmp";
+            try {
+                solution_write(local_scheme_, solution, tmp_path);
+                rename(tmp_path, certificate_path_);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                std::remove(tmp_path.c_str());
+            }
+        }
+    }
+
+    /**
+     * Copy of the local scheme, used by the writer thread while the search
+     * modifies the original one.
+     */
+    LocalScheme local_scheme_;
+
+    /** Path of the JSON output file. */
+    std::string json_output_path_;
+
+    /** Path of the certificate file. */
+    std::string certificate_path_;
+
+    /** Maximum number of intermediary outputs in the JSON output file. */
+    Counter maximum_number_of_intermediary_outputs_;
+
+    /** Whether the document has already been submitted; search side only. */
+    bool has_document_ = false;
+
+    /** Document submitted but not yet taken by the writer thread. */
+    std::unique_ptr<nlohmann::json> pending_document_;
+
+    /** Intermediary outputs submitted since the last write. */
+    std::vector<nlohmann::json> pending_intermediary_outputs_;
+
+    /** Latest submitted best solution not yet written. */
+    std::unique_ptr<Solution> pending_solution_;
+
+    /** JSON document without its intermediary outputs; writer thread only. */
+    nlohmann::json document_;
+
+    /** Latest intermediary outputs; writer thread only. */
+    std::deque<nlohmann::json> intermediary_outputs_;
+
+    /** Whether a state is being written. */
+    bool writing_ = false;
+
+    /** Whether the thread must stop once the pending state is written. */
+    bool stop_ = false;
+
+    std::mutex mutex_;
+
+    std::condition_variable cv_;
+
+    std::thread thread_;
+};
+
 template <typename LocalScheme>
 void read_args(
         const LocalScheme& local_scheme,
@@ -59,6 +285,11 @@ void read_args(
         parameters.log_path = vm["log"].as<std::string>();
     parameters.log_to_stderr = vm.count("log-to-stderr");
 
+    if (vm.count("trajectory"))
+        parameters.trajectory_path = vm["trajectory"].as<std::string>();
+    if (vm.count("maximum-number-of-intermediary-outputs"))
+        parameters.maximum_number_of_intermediary_outputs = vm["maximum-number-of-intermediary-outputs"].as<Counter>();
+
     parameters.has_goal = (vm.count("goal"));
     if (vm.count("goal"))
         parameters.goal = global_cost_goal(local_scheme, vm["goal"].as<double>());
@@ -67,17 +298,23 @@ void read_args(
     if (!only_write_at_the_end) {
         std::string certificate_path = vm["certificate"].as<std::string>();
         std::string json_output_path = vm["output"].as<std::string>();
-        parameters.new_solution_callback = [
-            local_scheme,
-            json_output_path,
-            certificate_path](
+        // Intermediate files are written in the background; the writer is
+        // flushed at the end of the algorithm, before write_outputs writes
+        // the final files.
+        auto writer = std::make_shared<AsyncOutputWriter<LocalScheme>>(
+                local_scheme,
+                json_output_path,
+                certificate_path,
+                parameters.maximum_number_of_intermediary_outputs);
+        parameters.new_solution_callback = [writer](
                     const Output<LocalScheme>& output)
         {
-            output.write_json_output(json_output_path);
-            solution_write(
-                    local_scheme,
-                    output.solution_pool.best(),
-                    certificate_path);
+            writer->submit(output);
+        };
+        parameters.end_callback = [writer](
+                    const Output<LocalScheme>&)
+        {
+            writer->flush();
         };
     }
 }
@@ -162,6 +399,8 @@ const Output<LocalScheme> run_iterated_local_search(
 {
     IteratedLocalSearchParameters<LocalScheme> parameters;
     read_args(local_scheme, parameters, vm);
+    if (vm.count("number-of-threads"))
+        parameters.number_of_threads = vm["number-of-threads"].as<Counter>();
     if (vm.count("maximum-number-of-restarts"))
         parameters.maximum_number_of_restarts = vm["maximum-number-of-restarts"].as<Counter>();
     if (vm.count("maximum-number-of-iterations"))
@@ -186,6 +425,22 @@ const Output<LocalScheme> run_best_first_local_search(
         parameters.number_of_threads_2 = vm["number-of-threads-2"].as<Counter>();
     if (vm.count("maximum-number-of-nodes"))
         parameters.maximum_number_of_nodes = vm["maximum-number-of-nodes"].as<Counter>();
+    if (vm.count("fingerprint-history"))
+        parameters.use_fingerprint_history = vm["fingerprint-history"].as<bool>();
+    if (vm.count("maximum-history-memory"))
+        parameters.maximum_history_memory = vm["maximum-history-memory"].as<Counter>();
+    if (vm.count("history-bloom-filter"))
+        parameters.use_history_bloom_filter = vm["history-bloom-filter"].as<bool>();
+    if (vm.count("delta-encoded-nodes"))
+        parameters.use_delta_encoded_nodes = vm["delta-encoded-nodes"].as<bool>();
+    if (vm.count("maximum-delta-chain-length"))
+        parameters.maximum_delta_chain_length = vm["maximum-delta-chain-length"].as<Counter>();
+    if (vm.count("maximum-size-of-the-node-cache"))
+        parameters.maximum_size_of_the_node_cache = vm["maximum-size-of-the-node-cache"].as<Counter>();
+    if (vm.count("maximum-number-of-children-per-window"))
+        parameters.maximum_number_of_children_per_window = vm["maximum-number-of-children-per-window"].as<Counter>();
+    if (vm.count("maximum-number-of-cached-children"))
+        parameters.maximum_number_of_cached_children = vm["maximum-number-of-cached-children"].as<Counter>();
     const Output<LocalScheme> output = best_first_local_search(local_scheme, parameters);
     write_outputs(output, vm);
     return output;
@@ -2,7 +2,9 @@
 
 #include "localsearchsolver/common.hpp"
 
+#include <atomic>
 #include <mutex>
+#include <fstream>
 
 namespace localsearchsolver
 {
@@ -38,7 +40,112 @@ public:
     /** Update the solution. */
     void update_solution(
             const Solution& solution_new,
-            const std::stringstream& s);
+            const std::stringstream& s) { update_solution_impl(solution_new, s, []() { }); }
+
+    /** Update the solution, moving it into the solution pool. */
+    void update_solution(
+            Solution&& solution_new,
+            const std::stringstream& s) { update_solution_impl(std::move(solution_new), s, []() { }); }
+
+    /**
+     * Update the solution; if it is a new best solution, 'update_output' is
+     * called while holding the lock, before the intermediary output is
+     * built, to refresh the statistics of the output.
+     */
+    template <typename S, typename UpdateOutput>
+    void update_solution(
+            S&& solution_new,
+            const std::stringstream& s,
+            UpdateOutput update_output) { update_solution_impl(std::forward<S>(solution_new), s, update_output); }
+
+    /**
+     * Check if a solution of cost 'global_cost' would be added to the
+     * solution pool.
+     *
+     * Unlike reading the solution pool directly, this can be called while
+     * other threads update the solution.
+     */
+    bool improves_solution_pool(
+            const typename LocalScheme::GlobalCost& global_cost)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return output_.solution_pool.size() == 0
+            || strictly_better(
+                    local_scheme_,
+                    global_cost,
+                    output_.solution_pool.worst_global_cost());
+    }
+
+    /** Check if the goal has been reached; thread-safe. */
+    bool goal_reached()
+    {
+        if (!parameters_.has_goal)
+            return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return output_.solution_pool.size() > 0
+            && !strictly_better(
+                    local_scheme_,
+                    parameters_.goal,
+                    output_.solution_pool.best_global_cost());
+    }
+
+    /**
+     * Copy of the best and worst global costs of the solution pool, owned by
+     * a thread.
+     *
+     * It is refreshed only when the solution pool has changed, so that the
+     * checks below do not lock the mutex for every node.
+     */
+    struct SolutionPoolBounds
+    {
+        /** Version of the solution pool at the time of the copy. */
+        Counter version = -1;
+
+        /** Whether the solution pool was empty. */
+        bool empty = true;
+
+        /** Best global cost of the solution pool. */
+        typename LocalScheme::GlobalCost best_global_cost{};
+
+        /** Worst global cost of the solution pool. */
+        typename LocalScheme::GlobalCost worst_global_cost{};
+    };
+
+    /**
+     * Same as 'improves_solution_pool(global_cost)', but using the copy
+     * 'bounds' of the calling thread.
+     *
+     * Like the locking version, the answer may miss a concurrent update by
+     * another thread; 'update_solution' checks the solution again anyway.
+     */
+    bool improves_solution_pool(
+            const typename LocalScheme::GlobalCost& global_cost,
+            SolutionPoolBounds& bounds)
+    {
+        refresh(bounds);
+        return bounds.empty
+            || strictly_better(
+                    local_scheme_,
+                    global_cost,
+                    bounds.worst_global_cost);
+    }
+
+    /**
+     * Same as 'goal_reached()', but using the copy 'bounds' of the calling
+     * thread.
+     */
+    bool goal_reached(
+            SolutionPoolBounds& bounds)
+    {
+        if (!parameters_.has_goal)
+            return false;
+        refresh(bounds);
+        return !bounds.empty
+            && !strictly_better(
+                    local_scheme_,
+                    parameters_.goal,
+                    bounds.best_global_cost);
+    }
 
     /** Method to call at the end of the algorithm. */
     void end();
@@ -49,6 +156,25 @@ private:
      * Private methods
      */
 
+    template <typename S, typename UpdateOutput>
+    void update_solution_impl(
+            S&& solution_new,
+            const std::stringstream& s,
+            const UpdateOutput& update_output);
+
+    /** Copy the bounds of the solution pool if it has changed since. */
+    void refresh(
+            SolutionPoolBounds& bounds)
+    {
+        if (solution_pool_version_.load(std::memory_order_acquire) == bounds.version)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        bounds.version = solution_pool_version_.load(std::memory_order_relaxed);
+        bounds.empty = (output_.solution_pool.size() == 0);
+        bounds.best_global_cost = output_.solution_pool.best_global_cost();
+        bounds.worst_global_cost = output_.solution_pool.worst_global_cost();
+    }
+
     /*
      * local_scheme_instance_format
      */
@@ -308,6 +434,27 @@ private:
     /** Messages stream. */
     std::unique_ptr<optimizationtools::ComposeStream> os_;
 
+    /** Buffer of the trajectory file. */
+    std::vector<char> trajectory_buffer_;
+
+    /** Trajectory file. */
+    std::ofstream trajectory_file_;
+
+    /**
+     * Latest intermediary outputs, as a circular buffer whose oldest element
+     * is at 'intermediary_outputs_start_'.
+     */
+    std::vector<nlohmann::json> intermediary_outputs_;
+
+    /** Position of the oldest intermediary output. */
+    std::size_t intermediary_outputs_start_ = 0;
+
+    /**
+     * Number of changes of the solution pool; written while holding
+     * 'mutex_'.
+     */
+    std::atomic<Counter> solution_pool_version_{0};
+
     /** mutex. */
     std::mutex mutex_;
 
@@ -322,6 +469,18 @@ void AlgorithmFormatter<LocalScheme>::start(
         const std::string& algorithm_name)
 {
     output_.json["Parameters"] = parameters_.to_json(output_.solution_pool.local_scheme());
+    output_.json["IntermediaryOutputs"] = nlohmann::json::array();
+    if (!parameters_.trajectory_path.empty()) {
+        // Lines are only written to disk when this buffer is full and at
+        // the end, so that improvements rarely wait for the disk.
+        trajectory_buffer_.resize(1 << 20);
+        trajectory_file_.rdbuf()->pubsetbuf(trajectory_buffer_.data(), trajectory_buffer_.size());
+        trajectory_file_.open(parameters_.trajectory_path);
+        if (!trajectory_file_.good()) {
+            throw std::runtime_error(
+                    "Unable to open file \"" + parameters_.trajectory_path + "\".");
+        }
+    }
 
     if (parameters_.verbosity_level == 0)
         return;
@@ -376,15 +535,33 @@ void AlgorithmFormatter<LocalScheme>::print(
 }
 
 template <typename LocalScheme>
-void AlgorithmFormatter<LocalScheme>::update_solution(
-        const typename LocalScheme::Solution& solution_new,
-        const std::stringstream& s)
+template <typename S, typename UpdateOutput>
+void AlgorithmFormatter<LocalScheme>::update_solution_impl(
+        S&& solution_new,
+        const std::stringstream& s,
+        const UpdateOutput& update_output)
 {
     mutex_.lock();
-    if (output_.solution_pool.add(solution_new) == 2) {
+    int status = output_.solution_pool.add(std::forward<S>(solution_new));
+    if (status != 0)
+        solution_pool_version_.fetch_add(1, std::memory_order_release);
+    if (status == 2) {
+        update_output();
         output_.time = parameters_.timer.elapsed_time();
         print(s);
-        output_.json["IntermediaryOutputs"].push_back(output_.to_json());
+        nlohmann::json intermediary_output = output_.to_json();
+        if (trajectory_file_.is_open())
+            trajectory_file_ << intermediary_output.dump() << '\n';
+        // Keep only the latest intermediary outputs; once the buffer is
+        // full, the oldest one is overwritten.
+        if (parameters_.maximum_number_of_intermediary_outputs < 0
+                || (Counter)intermediary_outputs_.size()
+                < parameters_.maximum_number_of_intermediary_outputs) {
+            intermediary_outputs_.push_back(std::move(intermediary_output));
+        } else if (!intermediary_outputs_.empty()) {
+            intermediary_outputs_[intermediary_outputs_start_] = std::move(intermediary_output);
+            intermediary_outputs_start_ = (intermediary_outputs_start_ + 1) % intermediary_outputs_.size();
+        }
         parameters_.new_solution_callback(output_);
     }
     mutex_.unlock();
@@ -395,6 +572,17 @@ void AlgorithmFormatter<LocalScheme>::end()
 {
     output_.time = parameters_.timer.elapsed_time();
     output_.json["Output"] = output_.to_json();
+    nlohmann::json& intermediary_outputs = output_.json["IntermediaryOutputs"];
+    intermediary_outputs = nlohmann::json::array();
+    for (std::size_t pos = 0; pos < intermediary_outputs_.size(); ++pos) {
+        intermediary_outputs.push_back(std::move(intermediary_outputs_[
+                    (intermediary_outputs_start_ + pos) % intermediary_outputs_.size()]));
+    }
+    intermediary_outputs_.clear();
+    intermediary_outputs_start_ = 0;
+    if (trajectory_file_.is_open())
+        trajectory_file_.close();
+    parameters_.end_callback(output_);
 
     if (parameters_.verbosity_level == 0)
         return;
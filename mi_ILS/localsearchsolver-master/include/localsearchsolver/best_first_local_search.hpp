@@ -5,6 +5,14 @@
 #include <unordered_set>
 #include <thread>
 #include <random>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <stdexcept>
 
 namespace localsearchsolver
 {
@@ -24,13 +32,78 @@ struct BestFirstLocalSearchParameters: Parameters<LocalScheme>
     /** Number of threads running on the same node pool in parallel. */
     Counter number_of_threads_2 = 1;
 
+    /**
+     * Store only 128-bit fingerprints of the visited solutions in the
+     * history instead of their compact solutions.
+     */
+    bool use_fingerprint_history = false;
+
+    /**
+     * Maximum memory used by the fingerprint history, in bytes; once it is
+     * reached, the oldest fingerprints are forgotten. -1 for no limit.
+     *
+     * It is split among the shards of the history, each of which needs at
+     * least 'FingerprintSet::minimum_memory'; smaller limits are rejected.
+     */
+    Counter maximum_history_memory = -1;
+
+    /** Check a Bloom filter before looking up the fingerprint history. */
+    bool use_history_bloom_filter = false;
+
+    /**
+     * Store in each node its parent and the change from the solution of its
+     * parent instead of its compact solution.
+     *
+     * Only used with the fingerprint history, since otherwise the history
+     * keeps the compact solutions anyway, and if the local scheme provides
+     * 'compact_solution_delta' and 'apply_compact_solution_delta'.
+     */
+    bool use_delta_encoded_nodes = false;
+
+    /**
+     * Maximum number of deltas between a node and its closest ancestor which
+     * stores its compact solution.
+     */
+    Counter maximum_delta_chain_length = 16;
+
+    /**
+     * Maximum number of solutions of recently expanded nodes kept to avoid
+     * rebuilding them with 'compact2solution'.
+     */
+    Counter maximum_size_of_the_node_cache = 0;
+
+    /**
+     * Maximum number of children of a node sorted at once; the next ones are
+     * only sorted once the current ones have been used.
+     */
+    Counter maximum_number_of_children_per_window = 1024;
+
+    /**
+     * Maximum number of children kept in each node beyond the ones of the
+     * current window, so that the next window does not require generating
+     * the perturbations again.
+     *
+     * A window taken from the cache costs O(window log cache); without the
+     * cache, all the perturbations of the node are generated and partitioned
+     * again, which costs O(number of perturbations).
+     */
+    Counter maximum_number_of_cached_children = 1024;
+
 
     virtual nlohmann::json to_json(
             const LocalScheme& local_scheme) const override
     {
         nlohmann::json json = Parameters<LocalScheme>::to_json(local_scheme);
         json.merge_patch({
-            {"MaximumNumberOfNodes", maximum_number_of_nodes}});
+            {"MaximumNumberOfNodes", maximum_number_of_nodes},
+            {"UseFingerprintHistory", use_fingerprint_history},
+            {"MaximumHistoryMemory", maximum_history_memory},
+            {"UseHistoryBloomFilter", use_history_bloom_filter},
+            {"UseDeltaEncodedNodes", use_delta_encoded_nodes},
+            {"MaximumDeltaChainLength", maximum_delta_chain_length},
+            {"MaximumSizeOfTheNodeCache", maximum_size_of_the_node_cache},
+            {"MaximumNumberOfChildrenPerWindow", maximum_number_of_children_per_window},
+            {"MaximumNumberOfCachedChildren", maximum_number_of_cached_children}});
         return json;
     }
 
@@ -44,6 +117,14 @@ struct BestFirstLocalSearchParameters: Parameters<LocalScheme>
         int width = format_width();
         os
             << std::setw(width) << std::left << "Maximum number of nodes: " << maximum_number_of_nodes << std::endl
+            << std::setw(width) << std::left << "Use fingerprint history: " << use_fingerprint_history << std::endl
+            << std::setw(width) << std::left << "Maximum history memory: " << maximum_history_memory << std::endl
+            << std::setw(width) << std::left << "Use history Bloom filter: " << use_history_bloom_filter << std::endl
+            << std::setw(width) << std::left << "Use delta-encoded nodes: " << use_delta_encoded_nodes << std::endl
+            << std::setw(width) << std::left << "Max. delta chain length: " << maximum_delta_chain_length << std::endl
+            << std::setw(width) << std::left << "Max. size of node cache: " << maximum_size_of_the_node_cache << std::endl
+            << std::setw(width) << std::left << "Max. children per window: " << maximum_number_of_children_per_window << std::endl
+            << std::setw(width) << std::left << "Max. cached children: " << maximum_number_of_cached_children << std::endl
             ;
     }
 };
@@ -61,16 +142,53 @@ struct BestFirstLocalSearchOutput: Output<LocalScheme>
     /** Number of nodes. */
     Counter number_of_nodes = 0;
 
+    /** Number of tabu perturbations deferred. */
+    Counter number_of_deferred_nodes = 0;
+
+    /** Number of tabu perturbations added back to the queue. */
+    Counter number_of_released_nodes = 0;
+
+    /** Number of solutions in the history at the end of the search. */
+    Counter history_size = 0;
+
+    /**
+     * Number of bits of the fingerprints of the history; 0 if the history
+     * stores compact solutions.
+     */
+    Counter fingerprint_bits = 0;
+
+    /** Memory used by the fingerprint history, in bytes. */
+    Counter history_memory = 0;
+
+    /** Number of fingerprints forgotten to respect the memory limit. */
+    Counter number_of_evicted_fingerprints = 0;
+
+    /**
+     * Upper bound on the probability that two different solutions got the
+     * same fingerprint, in which case the second one was wrongly skipped.
+     */
+    double history_collision_probability = 0.0;
+
 
     virtual nlohmann::json to_json() const override
     {
         nlohmann::json json = Output<LocalScheme>::to_json();
         json.merge_patch({
-            {"NumberOfNodes", number_of_nodes}});
+            {"NumberOfNodes", number_of_nodes},
+            {"NumberOfDeferredNodes", number_of_deferred_nodes},
+            {"NumberOfReleasedNodes", number_of_released_nodes},
+            {"HistorySize", history_size}});
+        if (fingerprint_bits > 0) {
+            json.merge_patch({
+                {"FingerprintBits", fingerprint_bits},
+                {"HistoryMemory", history_memory},
+                {"NumberOfEvictedFingerprints", number_of_evicted_fingerprints},
+                {"HistoryCollisionProbability", history_collision_probability}});
+        }
         return json;
     }
 
-    virtual int format_width() const override { return 18; }
+    virtual int format_width() const override { return 23; }
 
     virtual void format(std::ostream& os) const override
     {
@@ -78,7 +196,18 @@ struct BestFirstLocalSearchOutput: Output<LocalScheme>
         int width = format_width();
         os
             << std::setw(width) << std::left << "Number of nodes: " << number_of_nodes << std::endl
+            << std::setw(width) << std::left << "Deferred nodes: " << number_of_deferred_nodes << std::endl
+            << std::setw(width) << std::left << "Released nodes: " << number_of_released_nodes << std::endl
+            << std::setw(width) << std::left << "History size: " << history_size << std::endl
             ;
+        if (fingerprint_bits > 0) {
+            os
+                << std::setw(width) << std::left << "Fingerprint bits: " << fingerprint_bits << std::endl
+                << std::setw(width) << std::left << "History memory (MB): " << (double)history_memory / 1024 / 1024 << std::endl
+                << std::setw(width) << std::left << "Evicted fingerprints: " << number_of_evicted_fingerprints << std::endl
+                << std::setw(width) << std::left << "Collision probability: " << history_collision_probability << std::endl
+                ;
+        }
     }
 };
 
@@ -91,13 +220,109 @@ inline const BestFirstLocalSearchOutput<LocalScheme> best_first_local_search(
 /////////////////////////// Template implementations //////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Whether the local scheme provides deltas between compact solutions, i.e.
+ * a type 'CompactSolutionDelta' and the methods
+ * 'CompactSolutionDelta compact_solution_delta(const CompactSolution& compact_solution_1, const CompactSolution& compact_solution_2) const'
+ * returning the change from 'compact_solution_1' to 'compact_solution_2' and
+ * 'void apply_compact_solution_delta(CompactSolution&, const CompactSolutionDelta&) const'.
+ */
+template<typename LocalScheme, typename = void>
+struct HasCompactSolutionDelta: std::false_type { };
+
+template<typename LocalScheme>
+struct HasCompactSolutionDelta<LocalScheme, decltype(
+        std::declval<const LocalScheme&>().compact_solution_delta(
+            std::declval<const typename LocalScheme::CompactSolution&>(),
+            std::declval<const typename LocalScheme::CompactSolution&>()),
+        std::declval<const LocalScheme&>().apply_compact_solution_delta(
+            std::declval<typename LocalScheme::CompactSolution&>(),
+            std::declval<const typename LocalScheme::CompactSolutionDelta&>()),
+        void())>: std::true_type { };
+
+/**
+ * Deltas between compact solutions.
+ *
+ * Without deltas from the local scheme, a delta is the whole compact
+ * solution; nodes are then never delta-encoded.
+ */
+template <typename LocalScheme, bool = HasCompactSolutionDelta<LocalScheme>::value>
+struct BestFirstLocalSearchDeltas
+{
+    using CompactSolution = typename LocalScheme::CompactSolution;
+    using Delta = CompactSolution;
+
+    static Delta delta(
+            const LocalScheme&,
+            const CompactSolution&,
+            const CompactSolution& compact_solution_2)
+    {
+        return compact_solution_2;
+    }
+
+    static void apply(
+            const LocalScheme&,
+            CompactSolution& compact_solution,
+            const Delta& delta)
+    {
+        compact_solution = delta;
+    }
+};
+
+template <typename LocalScheme>
+struct BestFirstLocalSearchDeltas<LocalScheme, true>
+{
+    using CompactSolution = typename LocalScheme::CompactSolution;
+    using Delta = typename LocalScheme::CompactSolutionDelta;
+
+    static Delta delta(
+            const LocalScheme& local_scheme,
+            const CompactSolution& compact_solution_1,
+            const CompactSolution& compact_solution_2)
+    {
+        return local_scheme.compact_solution_delta(compact_solution_1, compact_solution_2);
+    }
+
+    static void apply(
+            const LocalScheme& local_scheme,
+            CompactSolution& compact_solution,
+            const Delta& delta)
+    {
+        local_scheme.apply_compact_solution_delta(compact_solution, delta);
+    }
+};
+
 template <typename LocalScheme>
 struct BestFirstLocalSearchNode
 {
     using CompactSolution = typename LocalScheme::CompactSolution;
     using Perturbation = typename LocalScheme::Perturbation;
+    using Delta = typename BestFirstLocalSearchDeltas<LocalScheme>::Delta;
 
+    /** Compact solution; 'nullptr' if the node is delta-encoded. */
     std::shared_ptr<CompactSolution> compact_solution;
+
+    /** Parent of a delta-encoded node. */
+    std::shared_ptr<const BestFirstLocalSearchNode> parent;
+
+    /** Change from the solution of the parent of a delta-encoded node. */
+    Delta delta;
+
+    /**
+     * Number of deltas between the node and its closest ancestor with a
+     * compact solution.
+     */
+    Counter delta_chain_length = 0;
+
+    /**
+     * Next children after the ones of 'perturbations', as a heap, the best
+     * one at the top.
+     */
+    std::vector<Perturbation> cached_children;
+
+    /** Number of perturbations of the solution of the node; -1 if unknown. */
+    Counter number_of_children = -1;
+
     std::vector<Perturbation> perturbations;
     Counter id = -1;
     Counter depth;
@@ -142,92 +367,1066 @@ using PerturbationMap = std::unordered_map<
         typename LocalScheme::PerturbationHasher&,
         typename LocalScheme::PerturbationHasher&>;
 
+/**
+ * Fingerprint of a solution.
+ *
+ * A local scheme can provide
+ * 'std::pair<std::uint64_t, std::uint64_t> compact_solution_fingerprint(const CompactSolution&) const'
+ * returning two independent 64-bit hashes. Otherwise, the fingerprint is
+ * derived from the compact solution hasher and only has 64 bits.
+ */
+using SolutionFingerprint = std::pair<std::uint64_t, std::uint64_t>;
+
+template<typename, typename T>
+struct HasCompactSolutionFingerprintMethod
+{
+    static_assert(
+        std::integral_constant<T, false>::value,
+        "Second template parameter needs to be of function type.");
+};
+
+template<typename C, typename Ret, typename... Args>
+struct HasCompactSolutionFingerprintMethod<C, Ret(Args...)>
+{
+
+private:
+
+    template<typename T>
+    static constexpr auto check(T*) -> typename std::is_same<decltype(std::declval<T>().compact_solution_fingerprint(std::declval<Args>()...)), Ret>::type;
+
+    template<typename>
+    static constexpr std::false_type check(...);
+
+    typedef decltype(check<C>(0)) type;
+
+public:
+
+    static constexpr bool value = type::value;
+
+};
+
+template<typename LocalScheme>
+using HasCompactSolutionFingerprint = std::integral_constant<
+    bool,
+    HasCompactSolutionFingerprintMethod<const LocalScheme,
+    SolutionFingerprint(const typename LocalScheme::CompactSolution&)>::value>;
+
+template<typename LocalScheme>
+SolutionFingerprint compact_solution_fingerprint(
+        const LocalScheme& local_scheme,
+        typename LocalScheme::CompactSolutionHasher&,
+        const std::shared_ptr<typename LocalScheme::CompactSolution>& compact_solution,
+        std::true_type)
+{
+    return local_scheme.compact_solution_fingerprint(*compact_solution);
+}
+
+template<typename LocalScheme>
+SolutionFingerprint compact_solution_fingerprint(
+        const LocalScheme&,
+        typename LocalScheme::CompactSolutionHasher& compact_solution_hasher,
+        const std::shared_ptr<typename LocalScheme::CompactSolution>& compact_solution,
+        std::false_type)
+{
+    std::uint64_t hash = compact_solution_hasher(compact_solution);
+    // Spread the hash over the second half (splitmix64 finalizer).
+    std::uint64_t hash_2 = hash + 0x9e3779b97f4a7c15;
+    hash_2 = (hash_2 ^ (hash_2 >> 30)) * 0xbf58476d1ce4e5b9;
+    hash_2 = (hash_2 ^ (hash_2 >> 27)) * 0x94d049bb133111eb;
+    return {hash, hash_2 ^ (hash_2 >> 31)};
+}
+
+/**
+ * Set of solution fingerprints.
+ *
+ * Fingerprints are stored in open-addressing tables with linear probing,
+ * optionally behind a Bloom filter which answers most lookups of new
+ * solutions without touching the table.
+ *
+ * The set holds two generations. When the current table would have to grow
+ * beyond the memory limit, the previous generation is dropped and the
+ * current one becomes the previous one, so that the oldest fingerprints are
+ * forgotten first.
+ */
+class FingerprintSet
+{
+
+public:
+
+    /** Constructor. */
+    FingerprintSet(
+            Counter maximum_memory,
+            bool use_bloom_filter):
+        maximum_memory_(maximum_memory),
+        use_bloom_filter_(use_bloom_filter)
+    {
+        if (maximum_memory_ != -1) {
+            while (initial_capacity_ > minimum_capacity_
+                    && 2 * memory(initial_capacity_) > maximum_memory_)
+                initial_capacity_ /= 2;
+        }
+    }
+
+    /** Add a fingerprint; return false if it was already in the set. */
+    bool insert(SolutionFingerprint fingerprint)
+    {
+        // {0, 0} marks the empty slots.
+        if (fingerprint.first == 0 && fingerprint.second == 0)
+            fingerprint.second = 1;
+        if (contains(generations_[0], fingerprint)
+                || contains(generations_[1], fingerprint))
+            return false;
+
+        Generation& generation = generations_[0];
+        if (generation.slots.empty())
+            generation = Generation(initial_capacity_, use_bloom_filter_);
+        if (2 * (generation.size + 1) > (Counter)generation.slots.size()) {
+            Counter capacity = 2 * generation.slots.size();
+            // Half of the memory is kept for the previous generation.
+            if (maximum_memory_ == -1
+                    || 2 * memory(capacity) <= maximum_memory_) {
+                grow(generation, capacity);
+            } else {
+                number_of_evicted_fingerprints_ += generations_[1].size;
+                generations_[1] = std::move(generations_[0]);
+                generations_[0] = Generation(
+                        generations_[1].slots.size(),
+                        use_bloom_filter_);
+            }
+        }
+        add(generations_[0], fingerprint);
+        number_of_insertions_++;
+        return true;
+    }
+
+    /** Get the number of fingerprints in the set. */
+    Counter size() const { return generations_[0].size + generations_[1].size; }
+
+    /**
+     * Get the smallest memory limit a set can respect, in bytes: two
+     * generations of the minimum capacity.
+     */
+    static Counter minimum_memory(bool use_bloom_filter)
+    {
+        return 2 * minimum_capacity_
+            * ((Counter)sizeof(SolutionFingerprint) + ((use_bloom_filter)? 1: 0));
+    }
+
+    /** Get the memory used by the set, in bytes. */
+    Counter memory() const
+    {
+        return memory(generations_[0].slots.size())
+            + memory(generations_[1].slots.size());
+    }
+
+    /** Get the number of fingerprints added since the beginning. */
+    Counter number_of_insertions() const { return number_of_insertions_; }
+
+    /** Get the number of fingerprints forgotten. */
+    Counter number_of_evicted_fingerprints() const { return number_of_evicted_fingerprints_; }
+
+private:
+
+    struct Generation
+    {
+        Generation() { }
+
+        Generation(Counter capacity, bool use_bloom_filter):
+            slots(capacity, {0, 0}),
+            bloom_filter(use_bloom_filter? capacity / 8: 0, 0) { }
+
+        /** Open-addressing table; the size is a power of 2. */
+        std::vector<SolutionFingerprint> slots;
+
+        /** Bloom filter with 8 bits per slot; empty if not used. */
+        std::vector<std::uint64_t> bloom_filter;
+
+        /** Number of fingerprints in the table. */
+        Counter size = 0;
+    };
+
+    /** Get the memory used by a generation with 'capacity' slots. */
+    Counter memory(Counter capacity) const
+    {
+        return capacity * sizeof(SolutionFingerprint)
+            + ((use_bloom_filter_)? capacity: 0);
+    }
+
+    /** Get the position of the i-th bit of a fingerprint in a Bloom filter. */
+    static std::uint64_t bloom_filter_bit(
+            const Generation& generation,
+            const SolutionFingerprint& fingerprint,
+            int i)
+    {
+        std::uint64_t number_of_bits = 64 * generation.bloom_filter.size();
+        return (fingerprint.second + i * ((fingerprint.second >> 32) | 1)) & (number_of_bits - 1);
+    }
+
+    bool contains(
+            const Generation& generation,
+            const SolutionFingerprint& fingerprint) const
+    {
+        if (generation.size == 0)
+            return false;
+        if (!generation.bloom_filter.empty()) {
+            for (int i = 0; i < 3; ++i) {
+                std::uint64_t bit = bloom_filter_bit(generation, fingerprint, i);
+                if (!((generation.bloom_filter[bit / 64] >> (bit % 64)) & 1))
+                    return false;
+            }
+        }
+        std::uint64_t mask = generation.slots.size() - 1;
+        for (std::uint64_t pos = fingerprint.first & mask;
+                generation.slots[pos].first != 0 || generation.slots[pos].second != 0;
+                pos = (pos + 1) & mask) {
+            if (generation.slots[pos] == fingerprint)
+                return true;
+        }
+        return false;
+    }
+
+    /** Add a fingerprint which is not in the generation yet. */
+    static void add(
+            Generation& generation,
+            const SolutionFingerprint& fingerprint)
+    {
+        std::uint64_t mask = generation.slots.size() - 1;
+        std::uint64_t pos = fingerprint.first & mask;
+        while (generation.slots[pos].first != 0 || generation.slots[pos].second != 0)
+            pos = (pos + 1) & mask;
+        generation.slots[pos] = fingerprint;
+        for (int i = 0; i < 3 && !generation.bloom_filter.empty(); ++i) {
+            std::uint64_t bit = bloom_filter_bit(generation, fingerprint, i);
+            generation.bloom_filter[bit / 64] |= (std::uint64_t)1 << (bit % 64);
+        }
+        generation.size++;
+    }
+
+    /** Move a generation to a table with 'capacity' slots. */
+    void grow(
+            Generation& generation,
+            Counter capacity)
+    {
+        Generation generation_new(capacity, use_bloom_filter_);
+        for (const SolutionFingerprint& fingerprint: generation.slots)
+            if (fingerprint.first != 0 || fingerprint.second != 0)
+                add(generation_new, fingerprint);
+        generation = std::move(generation_new);
+    }
+
+    /** Maximum memory, in bytes; -1 for no limit. */
+    Counter maximum_memory_;
+
+    /** Use a Bloom filter in front of the tables. */
+    bool use_bloom_filter_;
+
+    /** Smallest capacity of a generation. */
+    static constexpr Counter minimum_capacity_ = 16;
+
+    /** Number of slots of the first table; allocated at the first insertion. */
+    Counter initial_capacity_ = 1024;
+
+    /** Current generation, then previous generation. */
+    Generation generations_[2];
+
+    /** Number of fingerprints added since the beginning. */
+    Counter number_of_insertions_ = 0;
+
+    /** Number of fingerprints forgotten. */
+    Counter number_of_evicted_fingerprints_ = 0;
+};
+
+/**
+ * Node queue shared by the threads of a node pool.
+ *
+ * The nodes are spread over several shards, each with its own mutex. A node
+ * is pushed to a random shard; a pop takes the best of the first nodes of
+ * two random shards. The queue is therefore only approximately best first,
+ * but threads rarely wait for each other.
+ */
+template <typename LocalScheme>
+class BestFirstLocalSearchQueue
+{
+    using NodePtr = std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>;
+
+    struct Shard
+    {
+        Shard(const BestFirstLocalSearchNodeComparator<LocalScheme>& comparator):
+            nodes(comparator) { }
+
+        std::mutex mutex;
+
+        NodeSet<LocalScheme> nodes;
+    };
+
+public:
+
+    /** Constructor. */
+    BestFirstLocalSearchQueue(
+            const LocalScheme& local_scheme,
+            Counter number_of_shards):
+        comparator_(local_scheme)
+    {
+        for (Counter shard_id = 0; shard_id < number_of_shards; ++shard_id)
+            shards_.push_back(std::unique_ptr<Shard>(new Shard(comparator_)));
+    }
+
+    /** Get the number of nodes in the queue. */
+    Counter size() const { return size_; }
+
+    /** Add a node to the queue. */
+    void push(
+            const NodePtr& node,
+            std::mt19937_64& generator)
+    {
+        std::uniform_int_distribution<Counter> d(0, shards_.size() - 1);
+        Shard& shard = *shards_[d(generator)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.nodes.insert(node);
+        size_++;
+    }
+
+    /** Remove a node from the queue; return 'nullptr' if it is empty. */
+    NodePtr pop(std::mt19937_64& generator)
+    {
+        if (size_ == 0)
+            return nullptr;
+        Counter number_of_shards = shards_.size();
+        if (number_of_shards > 1) {
+            std::uniform_int_distribution<Counter> d(0, number_of_shards - 1);
+            Counter shard_id_1 = d(generator);
+            Counter shard_id_2 = d(generator);
+            if (shard_id_2 == shard_id_1)
+                shard_id_2 = (shard_id_1 + 1) % number_of_shards;
+            Shard& shard_1 = *shards_[shard_id_1];
+            Shard& shard_2 = *shards_[shard_id_2];
+            std::lock(shard_1.mutex, shard_2.mutex);
+            std::lock_guard<std::mutex> lock_1(shard_1.mutex, std::adopt_lock);
+            std::lock_guard<std::mutex> lock_2(shard_2.mutex, std::adopt_lock);
+            Shard* shard = (!shard_1.nodes.empty())? &shard_1: nullptr;
+            if (!shard_2.nodes.empty()
+                    && (shard == nullptr
+                        || comparator_(*shard_2.nodes.begin(), *shard_1.nodes.begin())))
+                shard = &shard_2;
+            if (shard != nullptr)
+                return pop(*shard);
+        }
+        // Both shards were empty, look at all of them.
+        for (auto& shard: shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            if (!shard->nodes.empty())
+                return pop(*shard);
+        }
+        return nullptr;
+    }
+
+private:
+
+    /** Remove the first node of a locked non-empty shard. */
+    NodePtr pop(Shard& shard)
+    {
+        NodePtr node = *shard.nodes.begin();
+        shard.nodes.erase(shard.nodes.begin());
+        size_--;
+        return node;
+    }
+
+    /** Node comparator. */
+    BestFirstLocalSearchNodeComparator<LocalScheme> comparator_;
+
+    /** Shards. */
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    /** Number of nodes in the queue. */
+    std::atomic<Counter> size_{0};
+};
+
+/**
+ * Timing wheel of the tabu perturbations.
+ *
+ * A perturbation which is tabu at a node is deferred until the node
+ * "release_node_id"; it is stored, together with a handle to the node it
+ * comes from, in the bucket "release_node_id % number_of_buckets". Drawing
+ * the node "node_id" releases the due entries of the bucket
+ * "node_id % number_of_buckets".
+ *
+ * The wheel has at least as many buckets as the maximum tabu tenure, so an
+ * entry is released the first time its bucket is visited, unless the
+ * thread drawing its release node stopped before. Buckets keep their
+ * capacity, so that no memory is allocated once the wheel is warm, except
+ * after an unusually large release.
+ */
+template <typename LocalScheme>
+class BestFirstLocalSearchTabuWheel
+{
+    using Perturbation = typename LocalScheme::Perturbation;
+    using NodePtr = std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>;
+
+public:
+
+    struct Entry
+    {
+        /** Node whose perturbation is tabu. */
+        NodePtr node;
+
+        /** Tabu perturbation. */
+        Perturbation perturbation;
+
+        /** Node at which the perturbation is released. */
+        Counter release_node_id;
+
+        /**
+         * Whether the node was created for this perturbation only, in which
+         * case it can be reused when the perturbation is released.
+         */
+        bool reusable;
+    };
+
+    /** Constructor. */
+    BestFirstLocalSearchTabuWheel(Counter number_of_shards):
+        mutexes_(number_of_shards) { }
+
+    /**
+     * Allocate the buckets for a maximum tabu tenure; only the first call
+     * has an effect.
+     */
+    void initialize(Counter maximum_tabu_tenure)
+    {
+        std::call_once(initialized_, [this, maximum_tabu_tenure]()
+        {
+            Counter number_of_buckets = 1;
+            while (number_of_buckets <= maximum_tabu_tenure)
+                number_of_buckets *= 2;
+            buckets_.resize(number_of_buckets);
+        });
+    }
+
+    /** Defer a perturbation of a node. */
+    void add(
+            const NodePtr& node,
+            const Perturbation& perturbation,
+            Counter release_node_id,
+            bool reusable)
+    {
+        Counter bucket_id = release_node_id & (buckets_.size() - 1);
+        std::lock_guard<std::mutex> lock(mutexes_[bucket_id % mutexes_.size()]);
+        buckets_[bucket_id].push_back({node, perturbation, release_node_id, reusable});
+    }
+
+    /** Move the entries released at node 'node_id' to 'entries'. */
+    void release(
+            Counter node_id,
+            std::vector<Entry>& entries)
+    {
+        Counter bucket_id = node_id & (buckets_.size() - 1);
+        std::lock_guard<std::mutex> lock(mutexes_[bucket_id % mutexes_.size()]);
+        std::vector<Entry>& bucket = buckets_[bucket_id];
+        for (Counter pos = 0; pos < (Counter)bucket.size();) {
+            if (bucket[pos].release_node_id <= node_id) {
+                entries.push_back(std::move(bucket[pos]));
+                bucket[pos] = std::move(bucket.back());
+                bucket.pop_back();
+            } else {
+                pos++;
+            }
+        }
+        // Give back the memory of a bucket which was much larger than usual.
+        if (bucket.capacity() > 256 && 4 * bucket.size() < bucket.capacity())
+            bucket.shrink_to_fit();
+    }
+
+private:
+
+    std::once_flag initialized_;
+
+    /** Buckets; the number of buckets is a power of 2. */
+    std::vector<std::vector<Entry>> buckets_;
+
+    /** The bucket "bucket_id" is protected by "mutexes_[bucket_id % mutexes_.size()]". */
+    std::vector<std::mutex> mutexes_;
+};
+
+/**
+ * Least recently used cache of the solutions of nodes.
+ *
+ * Like the queue, the cache is split in shards, each with its own mutex. A
+ * cached node is kept alive by the cache until it is evicted or removed.
+ */
+template <typename LocalScheme>
+class BestFirstLocalSearchNodeCache
+{
+    using Solution = typename LocalScheme::Solution;
+    using Node = BestFirstLocalSearchNode<LocalScheme>;
+    using NodePtr = std::shared_ptr<Node>;
+
+    struct Entry
+    {
+        NodePtr node;
+
+        Solution solution;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+
+        /** Entries, the most recently used first. */
+        std::list<Entry> entries;
+
+        std::unordered_map<const Node*, typename std::list<Entry>::iterator> positions;
+    };
+
+public:
+
+    /** Constructor. */
+    BestFirstLocalSearchNodeCache(
+            Counter maximum_size,
+            Counter number_of_shards):
+        maximum_shard_size_((maximum_size <= 0)? 0:
+                std::max((Counter)1, maximum_size / number_of_shards))
+    {
+        if (maximum_shard_size_ == 0)
+            return;
+        for (Counter shard_id = 0; shard_id < number_of_shards; ++shard_id)
+            shards_.push_back(std::unique_ptr<Shard>(new Shard()));
+    }
+
+    /** Return true if the cache is used. */
+    bool enabled() const { return maximum_shard_size_ > 0; }
+
+    /** Get a copy of the solution of a node; 'nullptr' if it is not cached. */
+    std::unique_ptr<Solution> get(const Node* node)
+    {
+        if (!enabled())
+            return nullptr;
+        Shard& shard = this->shard(node);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.positions.find(node);
+        if (it == shard.positions.end())
+            return nullptr;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return std::unique_ptr<Solution>(new Solution(it->second->solution));
+    }
+
+    /** Add the solution of a node to the cache. */
+    void add(
+            const NodePtr& node,
+            Solution&& solution)
+    {
+        if (!enabled())
+            return;
+        Shard& shard = this->shard(node.get());
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.positions.find(node.get());
+        if (it != shard.positions.end()) {
+            it->second->solution = std::move(solution);
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return;
+        }
+        shard.entries.push_front({node, std::move(solution)});
+        shard.positions[node.get()] = shard.entries.begin();
+        if ((Counter)shard.entries.size() > maximum_shard_size_) {
+            shard.positions.erase(shard.entries.back().node.get());
+            shard.entries.pop_back();
+        }
+    }
+
+    /** Remove a node from the cache. */
+    void remove(const Node* node)
+    {
+        if (!enabled())
+            return;
+        Shard& shard = this->shard(node);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.positions.find(node);
+        if (it == shard.positions.end())
+            return;
+        shard.entries.erase(it->second);
+        shard.positions.erase(it);
+    }
+
+private:
+
+    Shard& shard(const Node* node)
+    {
+        return *shards_[std::hash<const Node*>()(node) % shards_.size()];
+    }
+
+    /** Maximum number of solutions in each shard; 0 if the cache is not used. */
+    Counter maximum_shard_size_;
+
+    /** Shards. */
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
 template <typename LocalScheme>
 struct BestFirstLocalSearchData
 {
+    using CompactSolution = typename LocalScheme::CompactSolution;
     using CompactSolutionHasher = typename LocalScheme::CompactSolutionHasher;
     using PerturbationHasher = typename LocalScheme::PerturbationHasher;
     using Perturbation = typename LocalScheme::Perturbation;
+    using Solution = typename LocalScheme::Solution;
+    using Node = BestFirstLocalSearchNode<LocalScheme>;
+    using NodePtr = std::shared_ptr<Node>;
+    using Deltas = BestFirstLocalSearchDeltas<LocalScheme>;
+
+    struct HistoryShard
+    {
+        HistoryShard(
+                CompactSolutionHasher& hasher,
+                Counter maximum_memory,
+                bool use_bloom_filter):
+            solutions{0, hasher, hasher},
+            fingerprints(maximum_memory, use_bloom_filter) { }
+
+        std::mutex mutex;
+
+        CompactSolutionSet<LocalScheme> solutions;
+
+        /** Fingerprints of the solutions, if 'use_fingerprint_history'. */
+        FingerprintSet fingerprints;
+    };
+
+    struct PerturbationShard
+    {
+        PerturbationShard(PerturbationHasher& hasher):
+            perturbation_nodes{0, hasher, hasher} { }
+
+        std::mutex mutex;
+
+        /**
+         * perturbation_nodes[perturbation] is the last node at which
+         * "perturbation" has been used as a perturbation.
+         */
+        PerturbationMap<LocalScheme> perturbation_nodes;
+    };
 
     BestFirstLocalSearchData(
             LocalScheme& local_scheme,
             const BestFirstLocalSearchParameters<LocalScheme>& parameters,
             AlgorithmFormatter<LocalScheme>& algorithm_formatter,
-            BestFirstLocalSearchOutput<LocalScheme>& output):
+            BestFirstLocalSearchOutput<LocalScheme>& output,
+            std::atomic<Counter>& number_of_expanded_nodes):
         local_scheme(local_scheme),
         parameters(parameters),
         algorithm_formatter(algorithm_formatter),
         output(output),
         compact_solution_hasher(local_scheme.compact_solution_hasher()),
-        history{0, compact_solution_hasher, compact_solution_hasher},
-        q(local_scheme),
+        number_of_shards(2 * std::max(parameters.number_of_threads_2, (Counter)1) - 1),
+        q(local_scheme, number_of_shards),
+        number_of_expanded_nodes(number_of_expanded_nodes),
         perturbation_hasher(local_scheme.perturbation_hasher()),
-        perturbation_nodes{0, perturbation_hasher, perturbation_hasher}
-        {  }
+        tabu_wheel(number_of_shards),
+        use_delta_encoded_nodes(
+                parameters.use_delta_encoded_nodes
+                && parameters.use_fingerprint_history
+                && HasCompactSolutionDelta<LocalScheme>::value),
+        node_cache(parameters.maximum_size_of_the_node_cache, number_of_shards)
+    {
+        // The memory limit of the history is shared by all node pools and
+        // all shards.
+        Counter maximum_history_memory = (parameters.maximum_history_memory == -1)? -1:
+            parameters.maximum_history_memory
+            / std::max(parameters.number_of_threads_1, (Counter)1)
+            / number_of_shards;
+        for (Counter shard_id = 0; shard_id < number_of_shards; ++shard_id) {
+            history.push_back(std::unique_ptr<HistoryShard>(
+                        new HistoryShard(
+                            compact_solution_hasher,
+                            maximum_history_memory,
+                            parameters.use_history_bloom_filter)));
+            perturbation_shards.push_back(std::unique_ptr<PerturbationShard>(
+                        new PerturbationShard(perturbation_hasher)));
+        }
+    }
 
     LocalScheme& local_scheme;
     const BestFirstLocalSearchParameters<LocalScheme>& parameters;
     AlgorithmFormatter<LocalScheme>& algorithm_formatter;
     BestFirstLocalSearchOutput<LocalScheme>& output;
     CompactSolutionHasher compact_solution_hasher;
-    CompactSolutionSet<LocalScheme> history;
-    NodeSet<LocalScheme> q;
-    Counter number_of_working_threads = 0;
-    Counter initial_solution_pos = 0;
-    Counter number_of_perturbations = -1;
+
+    /**
+     * Number of shards of the queue, of the history, of the perturbation
+     * map and of the tabu wheel.
+     */
+    Counter number_of_shards;
+
+    /** Visited solutions or their fingerprints, sharded by hash. */
+    std::vector<std::unique_ptr<HistoryShard>> history;
+
+    BestFirstLocalSearchQueue<LocalScheme> q;
+
+    std::atomic<Counter> initial_solution_pos{0};
+    std::atomic<Counter> number_of_perturbations{-1};
+
+    /** Number of nodes drawn from the queue. */
+    std::atomic<Counter> number_of_nodes{0};
+
+    /**
+     * Number of nodes expanded within the node limit, by the threads of all
+     * the node pools.
+     */
+    std::atomic<Counter>& number_of_expanded_nodes;
+
+    /**
+     * Number of nodes either in the queue or being processed by a thread.
+     *
+     * The search ends when it reaches 0: no node is left and no thread can
+     * create a new one.
+     */
+    std::atomic<Counter> number_of_pending_nodes{0};
 
     PerturbationHasher perturbation_hasher;
 
+    /** Last use of each perturbation, sharded by perturbation hash. */
+    std::vector<std::unique_ptr<PerturbationShard>> perturbation_shards;
+
+    /** Tabu perturbations waiting to be released. */
+    BestFirstLocalSearchTabuWheel<LocalScheme> tabu_wheel;
+
+    /** Number of tabu perturbations deferred. */
+    std::atomic<Counter> number_of_deferred_nodes{0};
+
+    /** Number of tabu perturbations added back to the queue. */
+    std::atomic<Counter> number_of_released_nodes{0};
+
+    /** Whether new nodes are delta-encoded. */
+    bool use_delta_encoded_nodes;
+
+    /** Solutions of recently expanded nodes. */
+    BestFirstLocalSearchNodeCache<LocalScheme> node_cache;
+
+    /** Number of threads waiting for a node. */
+    std::atomic<Counter> number_of_idle_threads{0};
+
     /**
-     * perturbation_nodes[perturbation] is last node at which perturbation "perturbation" has been used as a
-     * perturbation.
+     * Whether a thread has stopped the search (time limit, goal or node
+     * limit).
      */
-    PerturbationMap<LocalScheme> perturbation_nodes;
+    std::atomic<bool> stopped{false};
+
+    std::mutex idle_mutex;
+
+    std::condition_variable idle_cv;
+
+    /**
+     * Add a compact solution to the history; return false if it was already
+     * in it.
+     */
+    bool history_insert(const std::shared_ptr<CompactSolution>& compact_solution)
+    {
+        if (parameters.use_fingerprint_history) {
+            SolutionFingerprint fingerprint = compact_solution_fingerprint(
+                    local_scheme,
+                    compact_solution_hasher,
+                    compact_solution,
+                    HasCompactSolutionFingerprint<LocalScheme>());
+            HistoryShard& shard = *history[(fingerprint.first >> 32) % number_of_shards];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            return shard.fingerprints.insert(fingerprint);
+        }
+        HistoryShard& shard = *history[compact_solution_hasher(compact_solution) % number_of_shards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.solutions.insert(compact_solution).second;
+    }
+
+    /** Get the solution of a node. */
+    Solution node_solution(
+            const LocalScheme& local_scheme,
+            const Node* node)
+    {
+        // Go up to the closest ancestor whose solution is cached or stored.
+        std::vector<const Node*> path;
+        std::unique_ptr<Solution> solution = node_cache.get(node);
+        while (solution == nullptr && node->compact_solution == nullptr) {
+            path.push_back(node);
+            node = node->parent.get();
+            solution = node_cache.get(node);
+        }
+        if (path.empty()) {
+            if (solution != nullptr)
+                return std::move(*solution);
+            return local_scheme.compact2solution(*node->compact_solution);
+        }
+        // Then apply the deltas down to the node.
+        CompactSolution compact_solution = (solution != nullptr)?
+            local_scheme.solution2compact(*solution):
+            *node->compact_solution;
+        for (auto it = path.rbegin(); it != path.rend(); ++it)
+            Deltas::apply(local_scheme, compact_solution, (*it)->delta);
+        return local_scheme.compact2solution(compact_solution);
+    }
 
     /**
-     * tabu_nodes[number_of_nodes] is a vector a nodes which are currently tabu
-     * and should be released at node "number_of_nodes".
+     * Set the solution of a new child node, either as its compact solution
+     * or as a delta from the solution of its parent.
      */
-    std::unordered_map<Counter, std::vector<std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>>> tabu_nodes;
+    void set_node_solution(
+            const LocalScheme& local_scheme,
+            Node& child,
+            const NodePtr& parent,
+            const Solution& parent_solution,
+            const std::shared_ptr<CompactSolution>& compact_solution)
+    {
+        if (!use_delta_encoded_nodes
+                || parent->delta_chain_length + 1 > parameters.maximum_delta_chain_length) {
+            child.compact_solution = compact_solution;
+            return;
+        }
+        child.parent = parent;
+        child.delta = Deltas::delta(
+                local_scheme,
+                local_scheme.solution2compact(parent_solution),
+                *compact_solution);
+        child.delta_chain_length = parent->delta_chain_length + 1;
+    }
 
-    std::mutex mutex;
+    /**
+     * Release the memory of a node without children left; it may still be
+     * needed as the parent of delta-encoded nodes.
+     */
+    void release_node(Node& node)
+    {
+        node_cache.remove(&node);
+        std::vector<Perturbation>().swap(node.perturbations);
+        std::vector<Perturbation>().swap(node.cached_children);
+    }
+
+    /** Add a new node to the queue and wake up a waiting thread. */
+    void push(
+            const NodePtr& node,
+            std::mt19937_64& generator)
+    {
+        q.push(node, generator);
+        if (number_of_idle_threads > 0) {
+            { std::lock_guard<std::mutex> lock(idle_mutex); }
+            idle_cv.notify_one();
+        }
+    }
+
+    /** Remove a pending node; wake up all threads if it was the last one. */
+    void remove_pending_node()
+    {
+        if (--number_of_pending_nodes == 0) {
+            { std::lock_guard<std::mutex> lock(idle_mutex); }
+            idle_cv.notify_all();
+        }
+    }
+
+    /** Stop the search and wake up all threads. */
+    void stop()
+    {
+        stopped = true;
+        { std::lock_guard<std::mutex> lock(idle_mutex); }
+        idle_cv.notify_all();
+    }
+
+    /**
+     * Wait until the queue is not empty or the search is over.
+     *
+     * No timeout is needed: while a thread waits, at least one node is being
+     * processed by another thread, which will either push a node, remove the
+     * last pending node or stop the search, and each of them notifies.
+     */
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        number_of_idle_threads++;
+        idle_cv.wait(
+                lock,
+                [this]()
+                {
+                    return q.size() > 0
+                        || number_of_pending_nodes == 0
+                        || stopped;
+                });
+        number_of_idle_threads--;
+    }
 };
 
+/**
+ * Whether the local scheme provides its perturbations one by one, through
+ * 'void for_each_perturbation(const Solution&, std::mt19937_64&, const std::function<void(const Perturbation&)>&)',
+ * in which case only the best ones are kept in memory.
+ */
+template<typename LocalScheme, typename = void>
+struct HasPerturbationStream: std::false_type { };
+
+template<typename LocalScheme>
+struct HasPerturbationStream<LocalScheme, decltype(
+        std::declval<LocalScheme&>().for_each_perturbation(
+            std::declval<const typename LocalScheme::Solution&>(),
+            std::declval<std::mt19937_64&>(),
+            std::declval<const std::function<void(const typename LocalScheme::Perturbation&)>&>()),
+        void())>: std::true_type { };
+
 template <typename LocalScheme>
-std::vector<typename LocalScheme::Perturbation> update_children(
+bool perturbation_compare(
+        const typename LocalScheme::Perturbation& perturbation_1,
+        const typename LocalScheme::Perturbation& perturbation_2)
+{
+    return perturbation_1.global_cost < perturbation_2.global_cost;
+}
+
+/**
+ * Get the perturbations of a solution; with a perturbation stream, only the
+ * 'number_of_perturbations_kept' best ones are returned.
+ */
+template <typename LocalScheme>
+std::vector<typename LocalScheme::Perturbation> generate_perturbations(
         LocalScheme& local_scheme,
         typename LocalScheme::Solution& solution,
         std::mt19937_64& generator,
-        Counter next_child_pos = 0)
+        Counter,
+        Counter& number_of_perturbations,
+        std::false_type)
 {
-    using Perturbation = typename LocalScheme::Perturbation;
+    auto perturbations = local_scheme.perturbations(solution, generator);
+    number_of_perturbations = perturbations.size();
+    return perturbations;
+}
 
-    auto perturbation_compare = [](const Perturbation& perturbation_1, const Perturbation& perturbation_2) -> bool
-    {
-        return perturbation_1.global_cost < perturbation_2.global_cost;
-    };
+template <typename LocalScheme>
+std::vector<typename LocalScheme::Perturbation> generate_perturbations(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution,
+        std::mt19937_64& generator,
+        Counter number_of_perturbations_kept,
+        Counter& number_of_perturbations,
+        std::true_type)
+{
+    using Perturbation = typename LocalScheme::Perturbation;
 
-    // Get perturbation perturbations.
-    auto perturbations_0 = local_scheme.perturbations(solution, generator);
-    if (next_child_pos >= (Counter)perturbations_0.size())
-        return {};
-    // Sort perturbations.
-    std::sort(perturbations_0.begin(), perturbations_0.end(), perturbation_compare);
+    // Max-heap of the best perturbations, the worst one at the top.
     std::vector<Perturbation> perturbations;
-    for (auto it = perturbations_0.begin() + next_child_pos;
-            it != perturbations_0.end() && it != perturbations_0.begin() + next_child_pos + 1024;
-            ++it)
-        perturbations.push_back(*it);
-    std::reverse(perturbations.begin(), perturbations.end());
+    number_of_perturbations = 0;
+    local_scheme.for_each_perturbation(
+            solution,
+            generator,
+            [&perturbations, &number_of_perturbations, number_of_perturbations_kept](
+                const Perturbation& perturbation)
+            {
+                number_of_perturbations++;
+                if ((Counter)perturbations.size() < number_of_perturbations_kept) {
+                    perturbations.push_back(perturbation);
+                    std::push_heap(perturbations.begin(), perturbations.end(), perturbation_compare<LocalScheme>);
+                } else if (perturbation_compare<LocalScheme>(perturbation, perturbations.front())) {
+                    std::pop_heap(perturbations.begin(), perturbations.end(), perturbation_compare<LocalScheme>);
+                    perturbations.back() = perturbation;
+                    std::push_heap(perturbations.begin(), perturbations.end(), perturbation_compare<LocalScheme>);
+                }
+            });
     return perturbations;
 }
 
+/**
+ * Get the next window of children of a node from its solution.
+ *
+ * The perturbations of the solution are generated again; the first
+ * 'node.next_child_pos' ones have already been used. Only the window is
+ * sorted, the best child last; the
+ * 'maximum_number_of_cached_children' next ones are kept in the node so that
+ * the following windows do not need the solution.
+ */
+template <typename LocalScheme>
+void update_children(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution,
+        std::mt19937_64& generator,
+        BestFirstLocalSearchNode<LocalScheme>& node,
+        Counter window_size,
+        Counter maximum_number_of_cached_children)
+{
+    using Perturbation = typename LocalScheme::Perturbation;
+    Counter next_child_pos = std::max(node.next_child_pos, (Counter)0);
+
+    node.perturbations.clear();
+    node.cached_children.clear();
+    std::vector<Perturbation> perturbations_0 = generate_perturbations(
+            local_scheme,
+            solution,
+            generator,
+            next_child_pos + window_size + maximum_number_of_cached_children,
+            node.number_of_children,
+            HasPerturbationStream<LocalScheme>());
+    if (next_child_pos >= node.number_of_children)
+        return;
+
+    // Partition the perturbations into the used ones, the window, the cached
+    // ones and the others.
+    auto compare = perturbation_compare<LocalScheme>;
+    Counter size = perturbations_0.size();
+    Counter window_end = std::min(size, next_child_pos + window_size);
+    Counter cache_end = std::min(size, window_end + maximum_number_of_cached_children);
+    auto first = perturbations_0.begin() + next_child_pos;
+    if (next_child_pos > 0)
+        std::nth_element(perturbations_0.begin(), first, perturbations_0.end(), compare);
+    if (cache_end < size)
+        std::nth_element(first, perturbations_0.begin() + cache_end, perturbations_0.end(), compare);
+    if (window_end < cache_end)
+        std::nth_element(first, perturbations_0.begin() + window_end, perturbations_0.begin() + cache_end, compare);
+    std::sort(first, perturbations_0.begin() + window_end, compare);
+
+    node.perturbations.assign(
+            std::make_reverse_iterator(perturbations_0.begin() + window_end),
+            std::make_reverse_iterator(first));
+    // Min-heap of the cached children, the best one at the top.
+    node.cached_children.assign(
+            perturbations_0.begin() + window_end,
+            perturbations_0.begin() + cache_end);
+    std::make_heap(
+            node.cached_children.begin(),
+            node.cached_children.end(),
+            [](const Perturbation& perturbation_1, const Perturbation& perturbation_2)
+            {
+                return perturbation_compare<LocalScheme>(perturbation_2, perturbation_1);
+            });
+}
+
+/**
+ * Get the next window of children of a node without its solution, from its
+ * cached children.
+ *
+ * Return false if the perturbations of its solution need to be generated
+ * again.
+ */
+template <typename LocalScheme>
+bool update_children(
+        BestFirstLocalSearchNode<LocalScheme>& node,
+        Counter window_size)
+{
+    using Perturbation = typename LocalScheme::Perturbation;
+
+    // All the children have been used.
+    if (node.number_of_children != -1
+            && node.next_child_pos >= node.number_of_children)
+        return true;
+    if (node.cached_children.empty())
+        return false;
+
+    auto compare = [](const Perturbation& perturbation_1, const Perturbation& perturbation_2)
+    {
+        return perturbation_compare<LocalScheme>(perturbation_2, perturbation_1);
+    };
+    while (!node.cached_children.empty()
+            && (Counter)node.perturbations.size() < window_size) {
+        std::pop_heap(node.cached_children.begin(), node.cached_children.end(), compare);
+        node.perturbations.push_back(std::move(node.cached_children.back()));
+        node.cached_children.pop_back();
+    }
+    std::reverse(node.perturbations.begin(), node.perturbations.end());
+    return true;
+}
+
 template <typename LocalScheme>
 inline void best_first_local_search_worker(
         BestFirstLocalSearchData<LocalScheme>& data,
         Counter thread_id)
 {
     using CompactSolution = typename LocalScheme::CompactSolution;
+    using NodePtr = std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>;
     //std::cout << "best_first_local_search_worker start" << std::endl;
 
     LocalScheme local_scheme_tmp(data.local_scheme);
@@ -235,6 +1434,7 @@ inline void best_first_local_search_worker(
         data.local_scheme: local_scheme_tmp;
     Seed seed = data.parameters.seed + thread_id;
     std::mt19937_64 generator(seed);
+    typename AlgorithmFormatter<LocalScheme>::SolutionPoolBounds solution_pool_bounds;
 
     // Generate initial solutions.
     for (;;) {
@@ -244,27 +1444,20 @@ inline void best_first_local_search_worker(
             break;
 
         // Check goal.
-        if (data.parameters.has_goal
-                && data.output.solution_pool.size() > 0
-                && !strictly_better(
-                    local_scheme,
-                    data.parameters.goal,
-                    local_scheme.global_cost(data.output.solution_pool.best())))
+        if (data.algorithm_formatter.goal_reached(solution_pool_bounds))
             break;
 
-        data.mutex.lock();
-        // Store initial_solution_pos to use it after releasing the mutex.
-        Counter initial_solution_pos = data.initial_solution_pos;
+        // The root node is pending from now on, so that the other threads
+        // do not stop while it is being generated.
+        data.number_of_pending_nodes++;
+        Counter initial_solution_pos = data.initial_solution_pos++;
         // No more initial solutions to generate.
         if (initial_solution_pos
                 >= (Counter)data.parameters.initial_solution_ids.size()
                 + (Counter)data.parameters.initial_solutions.size()) {
-            data.mutex.unlock();
+            data.remove_pending_node();
             break;
         }
-        data.initial_solution_pos++;
-        data.number_of_working_threads++;
-        data.mutex.unlock();
 
         auto solution = (initial_solution_pos < (Counter)data.parameters.initial_solution_ids.size())?
             local_scheme.initial_solution(data.parameters.initial_solution_ids[initial_solution_pos], generator):
@@ -272,11 +1465,9 @@ inline void best_first_local_search_worker(
         local_scheme.local_search(solution, generator);
 
         // Check for a new best solution.
-        if (data.output.solution_pool.size() == 0
-                || strictly_better(
-                    local_scheme,
+        if (data.algorithm_formatter.improves_solution_pool(
                     local_scheme.global_cost(solution),
-                    local_scheme.global_cost(data.output.solution_pool.worst()))) {
+                    solution_pool_bounds)) {
             std::stringstream ss;
             ss << "s" << initial_solution_pos
                 << " (t" << thread_id << ")";
@@ -284,210 +1475,249 @@ inline void best_first_local_search_worker(
         }
 
         // Get perturbation perturbations.
-        auto perturbations = update_children(local_scheme, solution, generator);
+        BestFirstLocalSearchNode<LocalScheme> root;
+        update_children(
+                local_scheme,
+                solution,
+                generator,
+                root,
+                data.parameters.maximum_number_of_children_per_window,
+                data.parameters.maximum_number_of_cached_children);
         auto compact_solution = std::shared_ptr<CompactSolution>(
                 new CompactSolution(local_scheme.solution2compact(solution)));
 
-        data.mutex.lock();
-        if (data.number_of_perturbations == -1)
-            data.number_of_perturbations = local_scheme.perturbations(solution, generator).size();
-        if (data.history.find(compact_solution) == data.history.end()
-                && perturbations.size() > 0) {
-            BestFirstLocalSearchNode<LocalScheme> root;
+        Counter number_of_perturbations = -1;
+        data.number_of_perturbations.compare_exchange_strong(
+                number_of_perturbations,
+                root.number_of_children);
+        if (!root.perturbations.empty() && data.history_insert(compact_solution)) {
             root.id = -1;
             root.compact_solution = compact_solution;
-            root.perturbations = perturbations;
             root.child_id = 0;
             root.depth = 1;
-            data.history.insert(compact_solution);
-            data.q.insert(std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>(
-                        new BestFirstLocalSearchNode<LocalScheme>(root)));
+            data.push(NodePtr(new BestFirstLocalSearchNode<LocalScheme>(std::move(root))), generator);
+        } else {
+            data.remove_pending_node();
         }
-        data.number_of_working_threads--;
-        data.mutex.unlock();
     }
 
+    std::vector<typename BestFirstLocalSearchTabuWheel<LocalScheme>::Entry> released_entries;
     for (;;) {
 
         // Check end.
-        if (data.parameters.timer.needs_to_end())
+        if (data.stopped || data.parameters.timer.needs_to_end()) {
+            data.stop();
             break;
+        }
 
         // Check goal.
-        if (data.parameters.has_goal
-                && data.output.solution_pool.size() > 0
-                && !strictly_better(
-                    local_scheme,
-                    data.parameters.goal,
-                    local_scheme.global_cost(data.output.solution_pool.best()))) {
+        if (data.algorithm_formatter.goal_reached(solution_pool_bounds)) {
+            data.stop();
             break;
         }
 
-        data.mutex.lock();
-
-        // Check for algorithm end.
-        if (data.q.empty() && data.number_of_working_threads == 0) {
-            data.mutex.unlock();
+        // Check node limit.
+        if (data.parameters.maximum_number_of_nodes != -1
+                && data.number_of_nodes >= data.parameters.maximum_number_of_nodes) {
+            data.stop();
             break;
         }
 
-        if (data.q.empty()) {
-            data.mutex.unlock();
+        // Draw next node from the queue. If the queue is empty, wait for
+        // another thread to add a node, unless no node is left at all.
+        NodePtr node_cur = data.q.pop(generator);
+        if (node_cur == nullptr) {
+            if (data.number_of_pending_nodes == 0)
+                break;
+            data.wait();
             continue;
         }
 
-        // Check node limit.
+        Counter node_id = data.number_of_nodes++;
         if (data.parameters.maximum_number_of_nodes != -1
-                && data.output.number_of_nodes >= data.parameters.maximum_number_of_nodes) {
-            data.mutex.unlock();
-            return;
+                && node_id >= data.parameters.maximum_number_of_nodes) {
+            data.q.push(node_cur, generator);
+            data.stop();
+            break;
         }
-
-        Counter node_id = data.output.number_of_nodes;
-        data.output.number_of_nodes++;
+        data.number_of_expanded_nodes++;
 
         // Compute tabu tenure.
+        Counter number_of_perturbations = data.number_of_perturbations;
         Counter tabu_tenure = -1;
-        if (node_id < data.number_of_perturbations) {
-            tabu_tenure = data.number_of_perturbations / 10;
-        } else if (node_id < 10 * data.number_of_perturbations) {
-            tabu_tenure = data.number_of_perturbations / 2;
+        if (node_id < number_of_perturbations) {
+            tabu_tenure = number_of_perturbations / 10;
+        } else if (node_id < 10 * number_of_perturbations) {
+            tabu_tenure = number_of_perturbations / 2;
         } else {
-            tabu_tenure = data.number_of_perturbations;
+            tabu_tenure = number_of_perturbations;
         }
 
-        // Add back nodes which are not tabu anymore.
-        if (data.tabu_nodes.find(node_id) != data.tabu_nodes.end()) {
-            for (auto node: data.tabu_nodes[node_id])
-                data.q.insert(node);
-            data.tabu_nodes.erase(node_id);
-        }
-
-        // Check goal.
-        if (data.parameters.has_goal
-                && data.output.solution_pool.size() > 0
-                && !strictly_better(
-                    local_scheme,
-                    data.parameters.goal,
-                    local_scheme.global_cost(data.output.solution_pool.best()))) {
-            break;
+        // Add back perturbations which are not tabu anymore.
+        data.tabu_wheel.initialize(number_of_perturbations);
+        released_entries.clear();
+        data.tabu_wheel.release(node_id, released_entries);
+        for (const auto& entry: released_entries) {
+            NodePtr node = entry.node;
+            if (!entry.reusable) {
+                // The node may still have other children; add a new node for
+                // this perturbation.
+                BestFirstLocalSearchNode<LocalScheme> node_tmp;
+                node_tmp.compact_solution = node->compact_solution;
+                node_tmp.parent = node->parent;
+                node_tmp.delta = node->delta;
+                node_tmp.delta_chain_length = node->delta_chain_length;
+                node_tmp.id = node->id;
+                node_tmp.depth = node->depth;
+                node_tmp.child_id = node->child_id;
+                node_tmp.next_child_pos = -1;
+                node = NodePtr(new BestFirstLocalSearchNode<LocalScheme>(node_tmp));
+            }
+            // Otherwise, the node was created for this perturbation only and
+            // nothing else refers to it, so it is reused.
+            node->perturbations = {entry.perturbation};
+            data.number_of_pending_nodes++;
+            data.push(node, generator);
         }
+        data.number_of_released_nodes += released_entries.size();
 
-        // Draw next node from the queue.
-        auto node_cur = *data.q.begin();
-        data.q.erase(data.q.begin());
         auto perturbation = node_cur->perturbations.back();
-        // Check if the perturbation is tabu.
-        while (data.perturbation_hasher.hashable(perturbation)
-                && data.perturbation_nodes.find(perturbation) != data.perturbation_nodes.end()
-                && data.perturbation_nodes[perturbation] > node_id - tabu_tenure) {
-            // Add a new node for this perturbation to the tabu node set.
-            BestFirstLocalSearchNode<LocalScheme> node_tmp;
-            node_tmp.compact_solution = node_cur->compact_solution;
-            node_tmp.perturbations = {perturbation};
-            node_tmp.id = node_cur->id;
-            node_tmp.depth = node_cur->depth;
-            node_tmp.child_id = node_cur->child_id;
-            node_tmp.next_child_pos = -1;
-            if (data.tabu_nodes.find(data.perturbation_nodes[perturbation] + tabu_tenure) == data.tabu_nodes.end())
-                data.tabu_nodes[data.perturbation_nodes[perturbation] + tabu_tenure] = {};
-            data.tabu_nodes[data.perturbation_nodes[perturbation] + tabu_tenure].push_back(
-                    std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>(
-                        new BestFirstLocalSearchNode<LocalScheme>(node_tmp)));
+        // Check if the perturbation is tabu; if not, mark it as used at this
+        // node.
+        for (;;) {
+            if (!data.perturbation_hasher.hashable(perturbation))
+                break;
+            auto& perturbation_shard = *data.perturbation_shards[
+                data.perturbation_hasher(perturbation) % data.number_of_shards];
+            Counter release_node_id = -1;
+            {
+                std::lock_guard<std::mutex> lock(perturbation_shard.mutex);
+                auto it = perturbation_shard.perturbation_nodes.find(perturbation);
+                if (it == perturbation_shard.perturbation_nodes.end()
+                        || it->second <= node_id - tabu_tenure) {
+                    perturbation_shard.perturbation_nodes[perturbation] = node_id;
+                    break;
+                }
+                release_node_id = it->second + tabu_tenure;
+            }
+
+            // Defer the perturbation; a node for it is created when it is
+            // released.
+            data.tabu_wheel.add(
+                    node_cur,
+                    perturbation,
+                    release_node_id,
+                    node_cur->next_child_pos == -1);
+            data.number_of_deferred_nodes++;
 
             // Remove the perturbation from the father's children.
             node_cur->perturbations.pop_back();
             if (node_cur->next_child_pos != -1) {
                 node_cur->next_child_pos++;
-                if (node_cur->perturbations.empty()) {
-                    auto solution_tmp = local_scheme.compact2solution(*node_cur->compact_solution);
-                    node_cur->perturbations = update_children(
+                if (node_cur->perturbations.empty()
+                        && !update_children(
+                                *node_cur,
+                                data.parameters.maximum_number_of_children_per_window)) {
+                    auto solution_tmp = data.node_solution(local_scheme, node_cur.get());
+                    update_children(
                             local_scheme,
                             solution_tmp,
                             generator,
-                            node_cur->next_child_pos);
+                            *node_cur,
+                            data.parameters.maximum_number_of_children_per_window,
+                            data.parameters.maximum_number_of_cached_children);
                 }
             }
-            if (!node_cur->perturbations.empty())
-                data.q.insert(node_cur);
+            if (!node_cur->perturbations.empty()) {
+                data.push(node_cur, generator);
+            } else {
+                data.release_node(*node_cur);
+                data.remove_pending_node();
+            }
 
-            node_cur = nullptr;
-            if (data.q.empty())
+            node_cur = data.q.pop(generator);
+            if (node_cur == nullptr)
                 break;
-
-            node_cur = *data.q.begin();
-            data.q.erase(data.q.begin());
             perturbation = node_cur->perturbations.back();
         }
-        if (node_cur == nullptr) {
-            data.mutex.unlock();
+        if (node_cur == nullptr)
             continue;
-        }
-        if (data.perturbation_hasher.hashable(perturbation))
-            data.perturbation_nodes[perturbation] = node_id;
-        data.number_of_working_threads++;
         //std::cout << "node " << node_id
         //    << " depth " << node_cur->depth
         //    << " cost " << to_string(local_scheme, perturbation.global_cost)
         //    << " thread " << thread_id
         //    << std::endl;
-        data.mutex.unlock();
 
-        auto solution = local_scheme.compact2solution(*node_cur->compact_solution);
+        auto solution_node = data.node_solution(local_scheme, node_cur.get());
         // Remove the perturbation from the father's children.
         node_cur->perturbations.pop_back();
         if (node_cur->next_child_pos != -1) {
             node_cur->next_child_pos++;
-            if (node_cur->perturbations.empty())
-                node_cur->perturbations = update_children(
+            if (node_cur->perturbations.empty()
+                    && !update_children(
+                            *node_cur,
+                            data.parameters.maximum_number_of_children_per_window)) {
+                update_children(
                         local_scheme,
-                        solution,
+                        solution_node,
                         generator,
-                        node_cur->next_child_pos);
+                        *node_cur,
+                        data.parameters.maximum_number_of_children_per_window,
+                        data.parameters.maximum_number_of_cached_children);
+            }
         }
+        // The solution of the node is kept for the node cache and for the
+        // deltas of its children.
+        bool keep_solution_node = data.node_cache.enabled() || data.use_delta_encoded_nodes;
+        auto solution = (keep_solution_node)? solution_node: std::move(solution_node);
         // Apply perturbation and local search.
         local_scheme.apply_perturbation(solution, perturbation, generator);
         local_scheme.local_search(solution, generator, perturbation);
 
         // Check for a new best solution.
-        if (data.output.solution_pool.size() == 0
-                || strictly_better(
-                    local_scheme,
+        if (data.algorithm_formatter.improves_solution_pool(
                     local_scheme.global_cost(solution),
-                    local_scheme.global_cost(data.output.solution_pool.worst()))) {
+                    solution_pool_bounds)) {
             std::stringstream ss;
             ss << "n" << node_id
                 << " d" << node_cur->depth
                 << " c" << node_cur->next_child_pos - 1
                 << " (t" << thread_id << ")";
-            data.algorithm_formatter.update_solution(solution, ss);
+            data.algorithm_formatter.update_solution(
+                    solution,
+                    ss,
+                    [&data]() { data.output.number_of_nodes = data.number_of_expanded_nodes; });
         }
 
         // Get perturbation perturbations.
-        auto perturbations = update_children(local_scheme, solution, generator);
+        BestFirstLocalSearchNode<LocalScheme> child;
+        update_children(
+                local_scheme,
+                solution,
+                generator,
+                child,
+                data.parameters.maximum_number_of_children_per_window,
+                data.parameters.maximum_number_of_cached_children);
         auto compact_solution = std::shared_ptr<CompactSolution>(
                     new CompactSolution(local_scheme.solution2compact(solution)));
 
-        data.mutex.lock();
-
-        if (data.history.find(compact_solution) == data.history.end()
-                && !perturbations.empty()) {
-            BestFirstLocalSearchNode<LocalScheme> child;
-            child.compact_solution = compact_solution;
-            child.perturbations = perturbations;
+        if (!child.perturbations.empty() && data.history_insert(compact_solution)) {
+            data.set_node_solution(local_scheme, child, node_cur, solution_node, compact_solution);
             child.id = node_id;
             child.depth = node_cur->depth + 1;
             child.child_id = node_cur->next_child_pos - 1;
-            data.history.insert(compact_solution);
-            data.q.insert(std::shared_ptr<BestFirstLocalSearchNode<LocalScheme>>(
-                        new BestFirstLocalSearchNode<LocalScheme>(child)));
+            data.number_of_pending_nodes++;
+            data.push(NodePtr(new BestFirstLocalSearchNode<LocalScheme>(std::move(child))), generator);
         }
 
-        if (!node_cur->perturbations.empty())
-            data.q.insert(node_cur);
-
-        data.number_of_working_threads--;
-        data.mutex.unlock();
+        if (!node_cur->perturbations.empty()) {
+            if (data.node_cache.enabled())
+                data.node_cache.add(node_cur, std::move(solution_node));
+            data.push(node_cur, generator);
+        } else {
+            data.release_node(*node_cur);
+            data.remove_pending_node();
+        }
     }
 }
 
@@ -496,6 +1726,27 @@ inline const BestFirstLocalSearchOutput<LocalScheme> best_first_local_search(
         LocalScheme& local_scheme,
         const BestFirstLocalSearchParameters<LocalScheme>& parameters)
 {
+    if (parameters.maximum_number_of_children_per_window < 1) {
+        throw std::invalid_argument(
+                "The maximum number of children per window"
+                " must be positive.");
+    }
+    if (parameters.use_fingerprint_history
+            && parameters.maximum_history_memory != -1) {
+        // The limit is split among the shards of all node pools.
+        Counter number_of_shards
+            = std::max(parameters.number_of_threads_1, (Counter)1)
+            * (2 * std::max(parameters.number_of_threads_2, (Counter)1) - 1);
+        Counter minimum_memory = number_of_shards
+            * FingerprintSet::minimum_memory(parameters.use_history_bloom_filter);
+        if (parameters.maximum_history_memory < minimum_memory) {
+            throw std::invalid_argument(
+                    "The maximum history memory must be at least "
+                    + std::to_string(minimum_memory)
+                    + " bytes with these numbers of threads.");
+        }
+    }
+
     BestFirstLocalSearchOutput<LocalScheme> output(
             local_scheme,
             parameters.maximum_size_of_the_solution_pool);
@@ -505,6 +1756,7 @@ inline const BestFirstLocalSearchOutput<LocalScheme> best_first_local_search(
 
     std::vector<std::thread> threads;
     std::vector<std::shared_ptr<BestFirstLocalSearchData<LocalScheme>>> datas;
+    std::atomic<Counter> number_of_expanded_nodes{0};
     Counter thread_id = 0;
     for (Counter thread_id_1 = 0; thread_id_1 < parameters.number_of_threads_1; ++thread_id_1) {
         datas.push_back(std::shared_ptr<BestFirstLocalSearchData<LocalScheme>>(
@@ -512,7 +1764,8 @@ inline const BestFirstLocalSearchOutput<LocalScheme> best_first_local_search(
                         local_scheme,
                         parameters,
                         algorithm_formatter,
-                        output)));
+                        output,
+                        number_of_expanded_nodes)));
         for (Counter thread_id_2 = 0; thread_id_2 < parameters.number_of_threads_2; ++thread_id_2) {
             threads.push_back(std::thread(
                         best_first_local_search_worker<LocalScheme>,
@@ -524,6 +1777,36 @@ inline const BestFirstLocalSearchOutput<LocalScheme> best_first_local_search(
     for (Counter thread_id = 0; thread_id < (Counter)threads.size(); ++thread_id)
         threads[thread_id].join();
 
+    output.number_of_nodes = number_of_expanded_nodes;
+    for (const auto& data: datas) {
+        output.number_of_deferred_nodes += data->number_of_deferred_nodes;
+        output.number_of_released_nodes += data->number_of_released_nodes;
+    }
+
+    // History statistics. The collision probability is bounded by the
+    // birthday bound on the fingerprints inserted in each node pool.
+    output.history_size = 0;
+    output.fingerprint_bits = 0;
+    if (parameters.use_fingerprint_history)
+        output.fingerprint_bits = (HasCompactSolutionFingerprint<LocalScheme>::value)? 128: 64;
+    for (const auto& data: datas) {
+        double number_of_insertions = 0;
+        for (const auto& shard: data->history) {
+            output.history_size += (parameters.use_fingerprint_history)?
+                shard->fingerprints.size():
+                (Counter)shard->solutions.size();
+            output.history_memory += shard->fingerprints.memory();
+            output.number_of_evicted_fingerprints += shard->fingerprints.number_of_evicted_fingerprints();
+            number_of_insertions += shard->fingerprints.number_of_insertions();
+        }
+        if (parameters.use_fingerprint_history) {
+            output.history_collision_probability += std::ldexp(
+                    number_of_insertions * (number_of_insertions - 1) / 2,
+                    -output.fingerprint_bits);
+        }
+    }
+    output.history_collision_probability = std::min(output.history_collision_probability, 1.0);
+
     algorithm_formatter.end();
     return output;
 }
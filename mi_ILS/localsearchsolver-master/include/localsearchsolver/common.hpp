@@ -4,6 +4,10 @@
 
 #include <cstdint>
 #include <set>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
 #include <iomanip>
 #include <sstream>
 
@@ -220,6 +224,124 @@ bool strictly_better(
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////// rollback ///////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Optional capability: a local scheme providing
+ *     void start_journal(Solution& solution);
+ *     void rollback(Solution& solution);
+ * records the changes made to 'solution' by apply_perturbation and
+ * local_search after start_journal, and rollback undoes them. Algorithms then
+ * perturb the current solution in place and roll it back instead of
+ * perturbing a full copy.
+ */
+
+template<typename, typename T>
+struct HasRollbackMethod
+{
+    static_assert(
+        std::integral_constant<T, false>::value,
+        "Second template parameter needs to be of function type.");
+};
+
+template<typename C, typename Ret, typename... Args>
+struct HasRollbackMethod<C, Ret(Args...)>
+{
+
+private:
+
+    template<typename T>
+    static constexpr auto check(T*) -> typename std::is_same<decltype(std::declval<T>().rollback(std::declval<Args>()...)), Ret>::type;
+
+    template<typename>
+    static constexpr std::false_type check(...);
+
+    typedef decltype(check<C>(0)) type;
+
+public:
+
+    static constexpr bool value = type::value;
+
+};
+
+template<typename LocalScheme>
+using HasRollback = std::integral_constant<
+    bool,
+    HasRollbackMethod<LocalScheme,
+    void(typename LocalScheme::Solution&)>::value>;
+
+/**
+ * Get the solution to perturb from 'solution'.
+ *
+ * Without rollback, 'solution' is copied into 'solution_tmp'; with rollback,
+ * 'solution' itself is returned and its changes start being journaled.
+ */
+template<typename LocalScheme>
+typename LocalScheme::Solution& start_perturbation(
+        LocalScheme&,
+        typename LocalScheme::Solution& solution,
+        typename LocalScheme::Solution& solution_tmp,
+        std::false_type)
+{
+    solution_tmp = solution;
+    return solution_tmp;
+}
+
+template<typename LocalScheme>
+typename LocalScheme::Solution& start_perturbation(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution,
+        typename LocalScheme::Solution&,
+        std::true_type)
+{
+    local_scheme.start_journal(solution);
+    return solution;
+}
+
+template<typename LocalScheme>
+typename LocalScheme::Solution& start_perturbation(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution,
+        typename LocalScheme::Solution& solution_tmp)
+{
+    return start_perturbation(
+            local_scheme,
+            solution,
+            solution_tmp,
+            HasRollback<LocalScheme>());
+}
+
+/** Restore 'solution' to its state before start_perturbation. */
+template<typename LocalScheme>
+void end_perturbation(
+        LocalScheme&,
+        typename LocalScheme::Solution&,
+        std::false_type)
+{
+}
+
+template<typename LocalScheme>
+void end_perturbation(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution,
+        std::true_type)
+{
+    local_scheme.rollback(solution);
+}
+
+template<typename LocalScheme>
+void end_perturbation(
+        LocalScheme& local_scheme,
+        typename LocalScheme::Solution& solution)
+{
+    end_perturbation(
+            local_scheme,
+            solution,
+            HasRollback<LocalScheme>());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////// dominates ///////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -359,56 +481,194 @@ std::string to_string(
 
 
 ////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////// Solution Pool /////////////////////////////////
+//////////////////////////////// Solution pool /////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Whether the local scheme provides compact solutions, i.e. the methods
+ * 'solution2compact' and 'compact_solution_hasher' also used by
+ * best_first_local_search.
+ */
+template<typename LocalScheme, typename = void>
+struct HasCompactSolution: std::false_type { };
+
+template<typename LocalScheme>
+struct HasCompactSolution<LocalScheme, decltype(
+        std::declval<LocalScheme>().solution2compact(std::declval<const typename LocalScheme::Solution&>()),
+        std::declval<LocalScheme>().compact_solution_hasher(),
+        void())>: std::true_type { };
+
+/**
+ * Keys used by the solution pool to detect duplicate solutions.
+ *
+ * Without compact solutions, no two keys are equal and duplicates are
+ * accepted.
+ */
+template <typename LocalScheme, bool = HasCompactSolution<LocalScheme>::value>
+struct SolutionPoolKeys
+{
+    using Solution = typename LocalScheme::Solution;
+
+    struct Key { };
+
+    SolutionPoolKeys(const LocalScheme&) { }
+
+    Key key(const Solution&) const { return Key(); }
+
+    Key key(const LocalScheme&, const Solution&) const { return Key(); }
+
+    bool equal(const Key&, const Key&) const { return false; }
+};
+
 template <typename LocalScheme>
-struct SolutionPoolComparator
+struct SolutionPoolKeys<LocalScheme, true>
 {
     using Solution = typename LocalScheme::Solution;
+    using CompactSolution = typename LocalScheme::CompactSolution;
+    using CompactSolutionHasher = typename LocalScheme::CompactSolutionHasher;
+
+    struct Key
+    {
+        /** Hash of the compact solution. */
+        std::size_t hash = 0;
 
-    SolutionPoolComparator(const LocalScheme& local_scheme):
-        local_scheme(local_scheme) { }
+        /** Compact solution. */
+        std::shared_ptr<CompactSolution> compact_solution;
+    };
+
+    SolutionPoolKeys(const LocalScheme& local_scheme):
+        local_scheme(local_scheme),
+        hasher(local_scheme.compact_solution_hasher()) { }
 
     const LocalScheme& local_scheme;
 
-    bool operator()(
-            const Solution& solution_1,
-            const Solution& solution_2) const {
-        return strictly_better(
-                local_scheme,
-                local_scheme.global_cost(solution_1),
-                local_scheme.global_cost(solution_2));
+    CompactSolutionHasher hasher;
+
+    Key key(const Solution& solution) const { return key(local_scheme, solution); }
+
+    /**
+     * Compute the key of a solution with the local scheme of the calling
+     * thread instead of the one of the solution pool.
+     */
+    Key key(
+            const LocalScheme& local_scheme,
+            const Solution& solution) const
+    {
+        Key key;
+        key.compact_solution = std::make_shared<CompactSolution>(
+                local_scheme.solution2compact(solution));
+        key.hash = hasher(key.compact_solution);
+        return key;
+    }
+
+    bool equal(const Key& key_1, const Key& key_2) const
+    {
+        return key_1.hash == key_2.hash
+            && hasher(key_1.compact_solution, key_2.compact_solution);
     }
 };
 
-////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////// Solution pool /////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////
-
+/**
+ * Pool of the best solutions found.
+ *
+ * Solutions are stored with their global cost, computed once when they are
+ * added, in a vector sorted from best to worst.
+ */
 template <typename LocalScheme>
 class SolutionPool
 {
     using Solution = typename LocalScheme::Solution;
     using GlobalCost = typename LocalScheme::GlobalCost;
+    using Key = typename SolutionPoolKeys<LocalScheme>::Key;
+
+    struct SolutionPoolSolution
+    {
+        /** Solution. */
+        Solution solution;
+
+        /** Global cost of the solution. */
+        GlobalCost global_cost;
+
+        /** Key of the solution. */
+        Key key;
+    };
 
 public:
 
+    /** Read-only iterator over the solutions of the pool. */
+    class SolutionIterator
+    {
+
+    public:
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Solution;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Solution*;
+        using reference = const Solution&;
+
+        SolutionIterator() { }
+
+        explicit SolutionIterator(typename std::vector<SolutionPoolSolution>::const_iterator it): it_(it) { }
+
+        reference operator*() const { return it_->solution; }
+        pointer operator->() const { return &it_->solution; }
+        SolutionIterator& operator++() { ++it_; return *this; }
+        SolutionIterator operator++(int) { SolutionIterator it = *this; ++it_; return it; }
+        SolutionIterator& operator--() { --it_; return *this; }
+        SolutionIterator operator--(int) { SolutionIterator it = *this; --it_; return it; }
+        bool operator==(const SolutionIterator& it) const { return it_ == it.it_; }
+        bool operator!=(const SolutionIterator& it) const { return it_ != it.it_; }
+
+    private:
+
+        typename std::vector<SolutionPoolSolution>::const_iterator it_;
+
+    };
+
+    /** Read-only view of the solutions of the pool, from best to worst. */
+    class Solutions
+    {
+
+    public:
+
+        explicit Solutions(const std::vector<SolutionPoolSolution>& solutions): solutions_(solutions) { }
+
+        SolutionIterator begin() const { return SolutionIterator(solutions_.begin()); }
+        SolutionIterator end() const { return SolutionIterator(solutions_.end()); }
+        std::size_t size() const { return solutions_.size(); }
+        bool empty() const { return solutions_.empty(); }
+
+    private:
+
+        const std::vector<SolutionPoolSolution>& solutions_;
+
+    };
+
     SolutionPool(const LocalScheme& local_scheme, Counter size_max):
         local_scheme_(local_scheme),
         size_max_(size_max),
-        solution_pool_comparator_(local_scheme),
-        solutions_(solution_pool_comparator_),
-        worst_(local_scheme.empty_solution()),
-        best_(local_scheme.empty_solution()) { }
+        keys_(local_scheme),
+        empty_solution_(local_scheme.empty_solution()),
+        empty_global_cost_(local_scheme.global_cost(empty_solution_)) { }
 
-    const std::multiset<Solution, SolutionPoolComparator<LocalScheme>>& solutions() const { return solutions_; };
+    /** Get the solutions of the pool, from best to worst. */
+    Solutions solutions() const { return Solutions(solutions_); }
+
+    /** Get the solution at position 'pos' of the pool, the best being at 0. */
+    const Solution& solution(Counter pos) const { return solutions_[pos].solution; }
 
     /** Get the best solution of the pool. */
-    const Solution& best() const { return best_; }
+    const Solution& best() const { return (solutions_.empty())? empty_solution_: solutions_.front().solution; }
 
     /** Get the worst solution fo the pool. */
-    const Solution& worst() const { return worst_; }
+    const Solution& worst() const { return (solutions_.empty())? empty_solution_: solutions_.back().solution; }
+
+    /** Get the global cost of best(). */
+    const GlobalCost& best_global_cost() const { return (solutions_.empty())? empty_global_cost_: solutions_.front().global_cost; }
+
+    /** Get the global cost of worst(). */
+    const GlobalCost& worst_global_cost() const { return (solutions_.empty())? empty_global_cost_: solutions_.back().global_cost; }
 
     /** Get the number of solutions in the pool. */
     Counter size() const { return solutions_.size(); }
@@ -416,58 +676,75 @@ public:
     /** Get the local scheme. */
     const LocalScheme& local_scheme() const { return local_scheme_; }
 
-    /** Add a solution to the pool. */
-    int add(
-            const Solution& solution)
+    /**
+     * Add a solution to the pool.
+     *
+     * Return 0 if the solution has not been added (it is not better than the
+     * worst solution of a full pool, or it is already in the pool), 2 if it
+     * is a new best solution and 1 otherwise.
+     */
+    int add(const Solution& solution) { return add_impl(solution); }
+
+    /** Add a solution to the pool, moving it in if it is added. */
+    int add(Solution&& solution) { return add_impl(std::move(solution)); }
+
+private:
+
+    template <typename S>
+    int add_impl(S&& solution)
     {
+        GlobalCost global_cost = local_scheme_.global_cost(solution);
         // If the solution is worse than the worst solution of the pool, stop.
-        if ((Counter)solutions_.size() >= size_max_) {
-            if (!strictly_better(
-                        local_scheme_,
-                        local_scheme_.global_cost(solution),
-                        local_scheme_.global_cost(*std::prev(solutions_.end())))) {
+        if ((Counter)solutions_.size() >= size_max_
+                && !strictly_better(local_scheme_, global_cost, worst_global_cost())) {
+            return 0;
+        }
+        // Solutions of equal cost precede the new one, as in a multiset.
+        auto it = std::upper_bound(
+                solutions_.begin(),
+                solutions_.end(),
+                global_cost,
+                [this](const GlobalCost& global_cost, const SolutionPoolSolution& solution_pool_solution)
+                {
+                    return strictly_better(local_scheme_, global_cost, solution_pool_solution.global_cost);
+                });
+        // If the solution is already in the pool, stop. A duplicate has the
+        // same cost, so it is among the solutions just before 'it'.
+        Key key = keys_.key(solution);
+        for (auto it_2 = it; it_2 != solutions_.begin();) {
+            --it_2;
+            if (strictly_better(local_scheme_, it_2->global_cost, global_cost))
+                break;
+            if (keys_.equal(it_2->key, key))
                 return 0;
-            }
         }
-        //for (const auto& solution_tmp: solutions_)
-        //    if (solution == solution_tmp)
-        //        return 0;
-        // If new best solution, display.
-        bool new_best = (solutions_.size() == 0)
-            || strictly_better(
-                    local_scheme_,
-                    local_scheme_.global_cost(solution),
-                    local_scheme_.global_cost(*solutions_.begin()));
+        bool new_best = (it == solutions_.begin());
         // Add new solution to solution pool.
-        solutions_.insert(solution);
+        solutions_.insert(it, SolutionPoolSolution{std::forward<S>(solution), global_cost, std::move(key)});
         // If the pool size is now above its maximum allowed size, remove worst
         // solutions from it.
         if ((Counter)solutions_.size() > size_max_)
-            solutions_.erase(std::prev(solutions_.end()));
-        best_ = *solutions_.begin();
-        worst_ = *std::prev(solutions_.end());
+            solutions_.pop_back();
         return (new_best)? 2: 1;
     }
 
-private:
-
     /** Local scheme. */
     const LocalScheme& local_scheme_;
 
     /** Maximum number of solutions in the solution pool. */
     Counter size_max_;
 
-    /** Solution comparator. */
-    SolutionPoolComparator<LocalScheme> solution_pool_comparator_;
+    /** Keys used to detect duplicate solutions. */
+    SolutionPoolKeys<LocalScheme> keys_;
 
-    /** Solutions. */
-    std::multiset<Solution, SolutionPoolComparator<LocalScheme>> solutions_;
+    /** Solutions, sorted from best to worst. */
+    std::vector<SolutionPoolSolution> solutions_;
 
-    /** Worst solution of the pool. */
-    Solution worst_;
+    /** Solution returned by best() and worst() when the pool is empty. */
+    Solution empty_solution_;
 
-    /** Best solution of the pool. */
-    Solution best_;
+    /** Global cost of 'empty_solution_'. */
+    GlobalCost empty_global_cost_;
 
 };
 
@@ -528,6 +805,26 @@ struct Parameters: optimizationtools::Parameters
     /** Callback function called when a new best solution is found. */
     NewSolutionCallback<LocalScheme> new_solution_callback = [](const Output<LocalScheme>&) { };
 
+    /** Callback function called at the end of the algorithm. */
+    std::function<void(const Output<LocalScheme>&)> end_callback = [](const Output<LocalScheme>&) { };
+
+    /**
+     * Maximum number of intermediary outputs kept in the JSON output; only
+     * the latest ones are kept. -1 for no limit.
+     *
+     * They are kept in a circular buffer during the search and written to
+     * output.json["IntermediaryOutputs"] at the end of the algorithm.
+     */
+    Counter maximum_number_of_intermediary_outputs = 1000;
+
+    /**
+     * Path of the trajectory file, in which each intermediary output is
+     * appended as one JSON line; no file if empty.
+     *
+     * The file is buffered and flushed at the end of the algorithm.
+     */
+    std::string trajectory_path = "";
+
     /** Ids of generated initial solutions. */
     std::vector<Counter> initial_solution_ids = {0};
 
@@ -559,6 +856,8 @@ struct Parameters: optimizationtools::Parameters
         nlohmann::json json = optimizationtools::Parameters::to_json();
         json.merge_patch({
             {"MaximumSizeOfTheSolutionPool", maximum_size_of_the_solution_pool},
+            {"MaximumNumberOfIntermediaryOutputs", maximum_number_of_intermediary_outputs},
+            {"TrajectoryPath", trajectory_path},
             {"Seed", seed},
             {"Goal", ((has_goal)? to_string(local_scheme, goal): "")}});
         return json;
@@ -110,13 +110,62 @@ class Population
 {
     using Solution = typename LocalScheme::Solution;
     using GlobalCost = typename LocalScheme::GlobalCost;
+    using Key = typename SolutionPoolKeys<LocalScheme>::Key;
 
-    struct PopulationSolution
+public:
+
+    /**
+     * Immutable part of a solution of the population.
+     *
+     * It is shared with the snapshots given to the threads so that they can
+     * compute distances outside of the lock.
+     */
+    struct Member
     {
-        PopulationSolution(const Solution& solution):
-            solution(solution) { }
+        /** Unique id of the member, increasing with insertion order. */
+        Counter id = -1;
+
+        /** Solution. */
+        Solution solution;
+
+        /** Global cost of the solution. */
+        GlobalCost global_cost;
+
+        /** Key used to detect duplicates. */
+        Key key;
+    };
+
+    using MemberPtr = std::shared_ptr<const Member>;
 
+    /**
+     * Solution which may be added to the population.
+     *
+     * Its key, its global cost and its distances to the members of a snapshot
+     * of the population are computed by 'candidate' without holding the lock.
+     */
+    struct Candidate
+    {
+        /** Solution. */
         Solution solution;
+
+        /** Global cost of the solution. */
+        GlobalCost global_cost;
+
+        /** Key used to detect duplicates. */
+        Key key;
+
+        /** Distances to the members of the snapshot, sorted by member id. */
+        std::vector<std::pair<Counter, double>> distances;
+
+        /** True if the solution is a duplicate of a member of the snapshot. */
+        bool duplicate = false;
+    };
+
+private:
+
+    struct PopulationSolution
+    {
+        MemberPtr member;
         double diversity = std::numeric_limits<double>::infinity();
         Counter diversity_rank = -1;
         Counter global_cost_rank = -1;
@@ -128,7 +177,8 @@ public:
     /** Constructor. */
     Population(const LocalScheme& local_scheme, Counter maximum_size_of_the_population):
         local_scheme_(local_scheme),
-        maximum_size_of_the_population_(maximum_size_of_the_population)
+        maximum_size_of_the_population_(maximum_size_of_the_population),
+        keys_(local_scheme)
     { }
 
     /** Destructor. */
@@ -137,6 +187,50 @@ public:
     /** Return the current number of solutions in the solution pool. */
     Counter size() const { return solutions_.size(); }
 
+    /** Return the members of the population. */
+    std::vector<MemberPtr> snapshot() const
+    {
+        std::vector<MemberPtr> members;
+        members.reserve(size());
+        for (const PopulationSolution& solution: solutions_)
+            members.push_back(solution.member);
+        return members;
+    }
+
+    /**
+     * Build a candidate from a solution and a snapshot of the population.
+     *
+     * This method doesn't modify the population and may be called without
+     * holding the lock, with the local scheme of the calling thread. The
+     * solution is moved into the candidate.
+     */
+    Candidate candidate(
+            const LocalScheme& local_scheme,
+            Solution solution,
+            const std::vector<MemberPtr>& members) const
+    {
+        GlobalCost global_cost = local_scheme.global_cost(solution);
+        Key key = keys_.key(local_scheme, solution);
+        Candidate candidate {std::move(solution), global_cost, std::move(key), {}, false};
+        candidate.distances.reserve(members.size());
+        for (const MemberPtr& member: members) {
+            if (keys_.equal(candidate.key, member->key)) {
+                candidate.duplicate = true;
+                return candidate;
+            }
+        }
+        for (const MemberPtr& member: members) {
+            double d = local_scheme.distance(candidate.solution, member->solution);
+            if (d == 0) {
+                candidate.duplicate = true;
+                return candidate;
+            }
+            candidate.distances.push_back({member->id, d});
+        }
+        std::sort(candidate.distances.begin(), candidate.distances.end());
+        return candidate;
+    }
+
     std::pair<Solution, Solution> get_parents_random(
             std::mt19937_64& generator)
     {
@@ -144,8 +238,8 @@ public:
         auto solution_ids = optimizationtools::bob_floyd(
                 (Counter)2, size(), generator);
         return {
-            solutions_[solution_ids[0]].solution,
-            solutions_[solution_ids[1]].solution};
+            solutions_[solution_ids[0]].member->solution,
+            solutions_[solution_ids[1]].member->solution};
     }
 
     std::pair<Solution, Solution> get_parents_binary_tournament(
@@ -175,8 +269,8 @@ public:
         }
 
         return {
-            solutions_[solution_id_1].solution,
-            solutions_[solution_id_2].solution};
+            solutions_[solution_id_1].member->solution,
+            solutions_[solution_id_2].member->solution};
     }
 
     /**
@@ -208,19 +302,63 @@ public:
             const Solution& solution,
             std::mt19937_64& generator)
     {
-        // Check if the solution is already in the population.
+        add(candidate(local_scheme_, solution, {}), generator);
+    }
+
+    /**
+     * Add a candidate to the population.
+     *
+     * Only the distances to the members added since the snapshot of the
+     * candidate was taken are computed here.
+     */
+    void add(
+            Candidate&& candidate,
+            std::mt19937_64& generator)
+    {
+        if (candidate.duplicate)
+            return;
+
+        // Check if the solution is already in the population. Keys are
+        // compared first, the distance is only computed to the members which
+        // are not in the snapshot.
         for (Counter solution_id = 0; solution_id < size(); ++solution_id) {
-            const Solution& solution_2 = solutions_[solution_id].solution;
-            if (local_scheme_.distance(solution, solution_2) == 0) {
+            if (keys_.equal(candidate.key, solutions_[solution_id].member->key)) {
                 //std::cout << "New solution is identical to solution " << solution_id << "." << std::endl;
                 return;
             }
         }
+        std::vector<double> row(size());
+        for (Counter solution_id = 0; solution_id < size(); ++solution_id) {
+            const Member& member = *solutions_[solution_id].member;
+            auto it = std::lower_bound(
+                    candidate.distances.begin(),
+                    candidate.distances.end(),
+                    std::pair<Counter, double>(member.id, -std::numeric_limits<double>::infinity()));
+            row[solution_id] = (it != candidate.distances.end() && it->first == member.id)?
+                it->second:
+                local_scheme_.distance(candidate.solution, member.solution);
+            if (row[solution_id] == 0)
+                return;
+        }
 
         // Add the new solution to the population.
-        PopulationSolution population_solution(solution);
         //std::cout << "Add new solution." << std::endl;
-        solutions_.push_back(population_solution);
+        PopulationSolution population_solution;
+        population_solution.member = std::make_shared<const Member>(Member{
+                next_member_id_++,
+                std::move(candidate.solution),
+                candidate.global_cost,
+                std::move(candidate.key)});
+        for (Counter solution_id = 0; solution_id < size(); ++solution_id) {
+            distances_[solution_id].push_back(row[solution_id]);
+            if (population_solution.diversity > row[solution_id])
+                population_solution.diversity = row[solution_id];
+            if (solutions_[solution_id].diversity > row[solution_id])
+                solutions_[solution_id].diversity = row[solution_id];
+        }
+        row.push_back(0);
+        distances_.push_back(std::move(row));
+        solutions_.push_back(std::move(population_solution));
         update_scores(generator);
 
         // If the maximum population size is exceeded, remove the worst
@@ -231,8 +369,7 @@ public:
                 if (solutions_[solution_id].rank == size() - 1)
                     solution_id_worse = solution_id;
             //std::cout << "Remove solution " << solution_id_worse << "." << std::endl;
-            solutions_[solution_id_worse] = solutions_.back();
-            solutions_.pop_back();
+            remove(solution_id_worse);
             update_scores(generator);
         }
     }
@@ -242,7 +379,7 @@ public:
         for (Counter solution_id = 0; solution_id < size(); ++solution_id) {
             const PopulationSolution& solution = solutions_[solution_id];
             std::cout << "Solution " << solution_id << ":"
-                << " cost " << to_string(local_scheme_, local_scheme_.global_cost(solution.solution))
+                << " cost " << to_string(local_scheme_, solution.member->global_cost)
                 << "; cost rank " << solution.global_cost_rank
                 << "; diversity: " << solution.diversity
                 << "; diversity rank: " << solution.diversity_rank
@@ -258,27 +395,52 @@ private:
      */
 
     /**
-     * Update the scores of the solutions of the population.
+     * Remove a solution from the population.
      *
-     * This method should be called each time the population is modified (when
-     * a solution is added or removed) since it affects these values.
+     * The solutions whose closest neighbor was the removed solution get their
+     * diversity recomputed from the distance matrix.
      */
-    void update_scores(std::mt19937_64& generator)
+    void remove(Counter solution_id_removed)
     {
-        // Compute diversities.
+        const std::vector<double>& row_removed = distances_[solution_id_removed];
         for (Counter solution_id = 0; solution_id < size(); ++solution_id) {
-            const Solution& solution = solutions_[solution_id].solution;
-            solutions_[solution_id].diversity = std::numeric_limits<double>::infinity();
+            if (solution_id == solution_id_removed
+                    || solutions_[solution_id].diversity < row_removed[solution_id])
+                continue;
+            double diversity = std::numeric_limits<double>::infinity();
             for (Counter solution_id_2 = 0; solution_id_2 < size(); ++solution_id_2) {
-                if (solution_id_2 == solution_id)
+                if (solution_id_2 == solution_id
+                        || solution_id_2 == solution_id_removed)
                     continue;
-                const Solution& solution_2 = solutions_[solution_id_2].solution;
-                double d = local_scheme_.distance(solution, solution_2);
-                if (solutions_[solution_id].diversity > d)
-                    solutions_[solution_id].diversity = d;
+                if (diversity > distances_[solution_id][solution_id_2])
+                    diversity = distances_[solution_id][solution_id_2];
             }
+            solutions_[solution_id].diversity = diversity;
         }
 
+        // Move the last solution in place of the removed one.
+        Counter solution_id_last = size() - 1;
+        if (solution_id_removed != solution_id_last) {
+            solutions_[solution_id_removed] = std::move(solutions_[solution_id_last]);
+            distances_[solution_id_removed] = std::move(distances_[solution_id_last]);
+            for (Counter solution_id = 0; solution_id < solution_id_last; ++solution_id)
+                distances_[solution_id][solution_id_removed] = distances_[solution_id][solution_id_last];
+        }
+        solutions_.pop_back();
+        distances_.pop_back();
+        for (std::vector<double>& row: distances_)
+            row.pop_back();
+    }
+
+    /**
+     * Update the ranks of the solutions of the population.
+     *
+     * This method should be called each time the population is modified (when
+     * a solution is added or removed) since it affects these values.
+     * Diversities are maintained by 'add' and 'remove'.
+     */
+    void update_scores(std::mt19937_64& generator)
+    {
         // Compute diversity_ranks.
         std::vector<Counter> diversity_ranks(size());
         std::iota(diversity_ranks.begin(), diversity_ranks.end(), 0);
@@ -303,8 +465,8 @@ private:
                 {
                     return strictly_better(
                             local_scheme_,
-                            local_scheme_.global_cost(solutions_[solution_id_1].solution),
-                            local_scheme_.global_cost(solutions_[solution_id_2].solution));
+                            solutions_[solution_id_1].member->global_cost,
+                            solutions_[solution_id_2].member->global_cost);
                 });
         for (Counter pos = 0; pos < size(); ++pos)
             solutions_[global_cost_ranks[pos]].global_cost_rank = pos;
@@ -337,9 +499,23 @@ private:
     /** Maximum size of the population. */
     Counter maximum_size_of_the_population_ = -1;
 
+    /** Keys used to detect duplicate solutions. */
+    SolutionPoolKeys<LocalScheme> keys_;
+
     /** Set of solutions. */
     std::vector<PopulationSolution> solutions_;
 
+    /**
+     * Distances between the solutions of the population.
+     *
+     * 'distances_[i][j]' is the distance between 'solutions_[i]' and
+     * 'solutions_[j]'.
+     */
+    std::vector<std::vector<double>> distances_;
+
+    /** Id of the next member. */
+    Counter next_member_id_ = 0;
+
 };
 
 template <typename LocalScheme>
@@ -400,12 +576,7 @@ inline void genetic_local_search_worker(
             break;
 
         // Check goal.
-        if (data.parameters.has_goal
-                && data.output.solution_pool.size() > 0
-                && !strictly_better(
-                    local_scheme,
-                    data.parameters.goal,
-                    local_scheme.global_cost(data.output.solution_pool.best())))
+        if (data.algorithm_formatter.goal_reached())
             break;
 
         data.mutex.lock();
@@ -416,6 +587,7 @@ inline void genetic_local_search_worker(
         }
         Counter initial_solution_pos = data.initial_solution_pos % number_of_initial_solutions;
         data.initial_solution_pos++;
+        auto members = data.population.snapshot();
         data.mutex.unlock();
 
         // Generate initial solution.
@@ -425,22 +597,21 @@ inline void genetic_local_search_worker(
         // Run A* Local Search.
         local_scheme.local_search(solution, generator);
         //std::cout << to_string(local_scheme, local_scheme.global_cost(solution)) << std::endl;
+        // Compute the distances to the population before taking the lock.
+        auto candidate = data.population.candidate(local_scheme, std::move(solution), members);
 
         // Lock mutex since we will modify the shared structure.
         data.mutex.lock();
-        // Add the new solution to the population.
-        data.population.add(solution, generator);
-        // Check for a new best solution.
-        if (data.output.solution_pool.size() == 0
-                || strictly_better(
-                    local_scheme,
-                    local_scheme.global_cost(solution),
-                    local_scheme.global_cost(data.output.solution_pool.worst()))) {
+        // Check for a new best solution; the solution pool gets a copy of
+        // the solution only in this case.
+        if (data.algorithm_formatter.improves_solution_pool(candidate.global_cost)) {
             std::stringstream ss;
             ss << "initial solution " << initial_solution_pos
                 << " (thread " << thread_id << ")";
-            data.algorithm_formatter.update_solution(solution, ss);
+            data.algorithm_formatter.update_solution(candidate.solution, ss);
         }
+        // Add the new solution to the population.
+        data.population.add(std::move(candidate), generator);
         // Unlock mutex.
         data.mutex.unlock();
     }
@@ -452,12 +623,7 @@ inline void genetic_local_search_worker(
             break;
 
         // Check goal.
-        if (data.parameters.has_goal
-                && data.output.solution_pool.size() > 0
-                && !strictly_better(
-                    local_scheme,
-                    data.parameters.goal,
-                    local_scheme.global_cost(data.output.solution_pool.best())))
+        if (data.algorithm_formatter.goal_reached())
             break;
 
         data.mutex.lock();
@@ -485,6 +651,7 @@ inline void genetic_local_search_worker(
                 generator);
         const auto& solution_parent_1 = p.first;
         const auto& solution_parent_2 = p.second;
+        auto members = data.population.snapshot();
 
         data.mutex.unlock();
 
@@ -493,22 +660,21 @@ inline void genetic_local_search_worker(
                 solution_parent_1, solution_parent_2, generator);
         // Run Local Search.
         local_scheme.local_search(solution, generator);
+        // Compute the distances to the population before taking the lock.
+        auto candidate = data.population.candidate(local_scheme, std::move(solution), members);
 
         // Lock mutex since we will modify the shared structure.
         data.mutex.lock();
-        // Add the new solution to the population.
-        data.population.add(solution, generator);
-        // Check for a new best solution.
-        if (data.output.solution_pool.size() == 0
-                || strictly_better(
-                    local_scheme,
-                    local_scheme.global_cost(solution),
-                    local_scheme.global_cost(data.output.solution_pool.worst()))) {
+        // Check for a new best solution; the solution pool gets a copy of
+        // the solution only in this case.
+        if (data.algorithm_formatter.improves_solution_pool(candidate.global_cost)) {
             std::stringstream ss;
             ss << "iteration " << number_of_iterations
                 << " (thread " << thread_id << ")";
-            data.algorithm_formatter.update_solution(solution, ss);
+            data.algorithm_formatter.update_solution(candidate.solution, ss);
         }
+        // Add the new solution to the population.
+        data.population.add(std::move(candidate), generator);
         // Unlock mutex.
         data.mutex.unlock();
     }
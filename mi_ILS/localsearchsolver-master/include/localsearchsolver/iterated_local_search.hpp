@@ -2,6 +2,10 @@
 
 #include "localsearchsolver/algorithm_formatter.hpp"
 
+#include <thread>
+#include <condition_variable>
+#include <memory>
+
 namespace localsearchsolver
 {
 
@@ -11,6 +15,17 @@ struct IteratedLocalSearchParameters: Parameters<LocalScheme>
     using Solution = typename LocalScheme::Solution;
     using GlobalCost = typename LocalScheme::GlobalCost;
 
+    /**
+     * Number of threads.
+     *
+     * With more than one thread, the perturbations of the current solution
+     * are evaluated by batches of 'number_of_threads', each on its own copy
+     * of the local scheme. The results of a batch are then processed in
+     * order, so the search is deterministic for a given seed and number of
+     * threads.
+     */
+    Counter number_of_threads = 1;
+
     /** Maximum number of iterations. */
     Counter maximum_number_of_iterations = -1;
 
@@ -35,6 +50,7 @@ struct IteratedLocalSearchParameters: Parameters<LocalScheme>
     {
         nlohmann::json json = Parameters<LocalScheme>::to_json(local_scheme);
         json.merge_patch({
+            {"NumberOfThreads", number_of_threads},
             {"MaximumNumberOfIterations", maximum_number_of_iterations},
             {"MaximumNumberOfRestarts", maximum_number_of_restarts},
             {"MinimumNumberOfPerturbations", minimum_number_of_perturbations}});
@@ -50,6 +66,7 @@ struct IteratedLocalSearchParameters: Parameters<LocalScheme>
         Parameters<LocalScheme>::format(os, local_scheme);
         int width = format_width();
         os
+            << std::setw(width) << std::left << "Number of threads: " << number_of_threads << std::endl
             << std::setw(width) << std::left << "Maximum number of iterations: " << maximum_number_of_iterations << std::endl
             << std::setw(width) << std::left << "Maximum number of restarts: " << maximum_number_of_restarts << std::endl
             << std::setw(width) << std::left << "Minimum number of perturbations: " << minimum_number_of_perturbations << std::endl
@@ -105,6 +122,193 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
 /////////////////////////// Template implementations //////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Structure storing what a thread of iterated_local_search works on: its
+ * copy of the local scheme, its generator and its copy of the current
+ * solution.
+ */
+template <typename LocalScheme>
+struct IteratedLocalSearchSlot
+{
+    using Solution = typename LocalScheme::Solution;
+
+    /** Constructor. */
+    IteratedLocalSearchSlot(
+            const LocalScheme& local_scheme,
+            Seed seed):
+        local_scheme(local_scheme),
+        generator(seed),
+        solution_cur(local_scheme.empty_solution()),
+        solution_copy(local_scheme.empty_solution())
+        { }
+
+    /** Local scheme. */
+    LocalScheme local_scheme;
+
+    /** Generator. */
+    std::mt19937_64 generator;
+
+    /** Copy of the current solution of the search. */
+    Solution solution_cur;
+
+    /** Identifier of the current solution copied in 'solution_cur'. */
+    Counter solution_cur_id = -1;
+
+    /** Buffer for local schemes without rollback. */
+    Solution solution_copy;
+
+    /**
+     * Solution obtained with the last perturbation, 'nullptr' once it has
+     * been rolled back.
+     */
+    Solution* solution_tmp = nullptr;
+};
+
+/**
+ * Thread pool applying a batch of perturbations to the current solution.
+ *
+ * Perturbation 'j' of a batch is always processed by slot 'j' (and thread
+ * 'j', the calling thread being thread 0), so the result of a batch does
+ * not depend on the scheduling.
+ */
+template <typename LocalScheme>
+class IteratedLocalSearchBatch
+{
+    using Solution = typename LocalScheme::Solution;
+    using Perturbation = typename LocalScheme::Perturbation;
+
+public:
+
+    /** Constructor. */
+    IteratedLocalSearchBatch(
+            const LocalScheme& local_scheme,
+            Counter number_of_threads,
+            Seed seed)
+    {
+        for (Counter slot_id = 0; slot_id < number_of_threads; ++slot_id) {
+            slots_.push_back(std::unique_ptr<IteratedLocalSearchSlot<LocalScheme>>(
+                        new IteratedLocalSearchSlot<LocalScheme>(local_scheme, seed + slot_id + 1)));
+        }
+        for (Counter slot_id = 1; slot_id < number_of_threads; ++slot_id) {
+            threads_.push_back(std::thread(
+                        &IteratedLocalSearchBatch::worker,
+                        this,
+                        slot_id));
+        }
+    }
+
+    /** Destructor. */
+    ~IteratedLocalSearchBatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_start_.notify_all();
+        for (std::thread& thread: threads_)
+            thread.join();
+    }
+
+    /**
+     * Apply each perturbation of 'perturbations' followed by a local search
+     * to a copy of 'solution_cur'.
+     *
+     * 'solution_cur_id' must change each time 'solution_cur' changes.
+     */
+    void run(
+            const Solution& solution_cur,
+            Counter solution_cur_id,
+            std::vector<Perturbation>& perturbations)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            solution_cur_ = &solution_cur;
+            solution_cur_id_ = solution_cur_id;
+            perturbations_ = &perturbations;
+            number_of_pending_threads_ = threads_.size();
+            batch_id_++;
+        }
+        cv_start_.notify_all();
+        run_slot(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_end_.wait(lock, [this]() { return number_of_pending_threads_ == 0; });
+    }
+
+    /** Get the solution obtained with the 'j'-th perturbation of the last batch. */
+    Solution& solution(Counter j) { return *slots_[j]->solution_tmp; }
+
+private:
+
+    void worker(Counter slot_id)
+    {
+        Counter batch_id = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_start_.wait(lock, [this, batch_id]() { return stop_ || batch_id_ != batch_id; });
+                if (stop_)
+                    return;
+                batch_id = batch_id_;
+            }
+            if (slot_id < (Counter)perturbations_->size())
+                run_slot(slot_id);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                number_of_pending_threads_--;
+            }
+            cv_end_.notify_one();
+        }
+    }
+
+    void run_slot(Counter slot_id)
+    {
+        IteratedLocalSearchSlot<LocalScheme>& slot = *slots_[slot_id];
+        // Roll back the perturbation of the previous batch.
+        if (slot.solution_tmp != nullptr) {
+            end_perturbation(slot.local_scheme, *slot.solution_tmp);
+            slot.solution_tmp = nullptr;
+        }
+        if (slot.solution_cur_id != solution_cur_id_) {
+            slot.solution_cur = *solution_cur_;
+            slot.solution_cur_id = solution_cur_id_;
+        }
+        Perturbation& perturbation = (*perturbations_)[slot_id];
+        slot.solution_tmp = &start_perturbation(slot.local_scheme, slot.solution_cur, slot.solution_copy);
+        slot.local_scheme.apply_perturbation(*slot.solution_tmp, perturbation, slot.generator);
+        slot.local_scheme.local_search(*slot.solution_tmp, slot.generator, perturbation);
+    }
+
+    /** Slots. */
+    std::vector<std::unique_ptr<IteratedLocalSearchSlot<LocalScheme>>> slots_;
+
+    /** Threads; slot 0 is processed by the calling thread. */
+    std::vector<std::thread> threads_;
+
+    /** Current solution of the current batch. */
+    const Solution* solution_cur_ = nullptr;
+
+    /** Identifier of the current solution of the current batch. */
+    Counter solution_cur_id_ = -1;
+
+    /** Perturbations of the current batch. */
+    std::vector<Perturbation>* perturbations_ = nullptr;
+
+    /** Identifier of the current batch. */
+    Counter batch_id_ = 0;
+
+    /** Number of threads which have not finished the current batch. */
+    Counter number_of_pending_threads_ = 0;
+
+    /** Whether the threads must stop. */
+    bool stop_ = false;
+
+    std::mutex mutex_;
+
+    std::condition_variable cv_start_;
+
+    std::condition_variable cv_end_;
+};
+
 template <typename LocalScheme>
 inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
         LocalScheme& local_scheme,
@@ -127,6 +331,18 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
 
     std::mt19937_64 generator(parameters.seed);
 
+    Counter number_of_threads = std::max(parameters.number_of_threads, (Counter)1);
+    std::unique_ptr<IteratedLocalSearchBatch<LocalScheme>> batch;
+    if (number_of_threads > 1) {
+        batch.reset(new IteratedLocalSearchBatch<LocalScheme>(
+                    local_scheme,
+                    number_of_threads,
+                    parameters.seed));
+    }
+    std::vector<Perturbation> batch_perturbations;
+    // Incremented each time solution_cur changes.
+    Counter solution_cur_id = 0;
+
     std::vector<Solution> initial_solutions;
     Counter number_of_initial_solutions
         = (Counter)parameters.initial_solution_ids.size()
@@ -147,7 +363,7 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
                 && !strictly_better(
                     local_scheme,
                     parameters.goal,
-                    local_scheme.global_cost(output.solution_pool.best())))
+                    output.solution_pool.best_global_cost()))
             break;
 
         // Generate initial solutions.
@@ -166,7 +382,7 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
                         || strictly_better(
                             local_scheme,
                             local_scheme.global_cost(solution_tmp),
-                            local_scheme.global_cost(output.solution_pool.worst()))) {
+                            output.solution_pool.worst_global_cost())) {
                     std::stringstream ss;
                     ss << "s" << output.number_of_restarts;
                     algorithm_formatter.update_solution(solution_tmp, ss);
@@ -187,13 +403,44 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
 
         Solution solution_cur = initial_solutions.back();
         initial_solutions.pop_back();
+        solution_cur_id++;
         Counter perturbation_id = 0;
         std::vector<Perturbation> perturbations = local_scheme.perturbations(solution_cur, generator);
         // Sort moves.
         std::sort(perturbations.begin(), perturbations.end(), move_compare);
         Counter depth = 1;
         Solution solution_next = solution_cur;
+        Solution solution_copy = local_scheme.empty_solution();
         bool better_found = false;
+
+        // Check a solution obtained from the perturbation 'perturbation_id'
+        // of solution_cur at iteration 'iteration'.
+        auto check_solution = [&](
+                const Solution& solution_tmp,
+                Counter perturbation_id,
+                Counter iteration)
+        {
+            // Check for a new best solution.
+            if (output.solution_pool.size() == 0
+                || strictly_better(
+                    local_scheme,
+                    local_scheme.global_cost(solution_tmp),
+                    output.solution_pool.worst_global_cost())) {
+                std::stringstream ss;
+                ss << "s" << output.number_of_restarts
+                    << " d" << depth
+                    << " c" << perturbation_id << "/" << perturbations.size()
+                    << " i" << iteration;
+                algorithm_formatter.update_solution(solution_tmp, ss);
+            }
+
+            if (local_scheme.global_cost(solution_next)
+                    > local_scheme.global_cost(solution_tmp)) {
+                solution_next = solution_tmp;
+                better_found = true;
+            }
+        };
+
         for (;; ++output.number_of_iterations) {
 
             // Check end.
@@ -206,12 +453,13 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
                     && !strictly_better(
                         local_scheme,
                         parameters.goal,
-                        local_scheme.global_cost(output.solution_pool.best())))
+                        output.solution_pool.best_global_cost()))
                 break;
 
             if (perturbation_id >= parameters.minimum_number_of_perturbations
                     && better_found) {
                 solution_cur = solution_next;
+                solution_cur_id++;
                 better_found = false;
                 perturbation_id = 0;
                 depth++;
@@ -223,31 +471,36 @@ inline const IteratedLocalSearchOutput<LocalScheme> iterated_local_search(
             if (perturbation_id >= (Counter)perturbations.size())
                 break;
 
-            // Apply perturbation and local search.
-            Solution solution_tmp = solution_cur;
+            if (number_of_threads > 1) {
+                // Apply a batch of perturbations in parallel, then check the
+                // solutions in the order of the perturbations.
+                Counter batch_size = std::min(
+                        number_of_threads,
+                        (Counter)perturbations.size() - perturbation_id);
+                batch_perturbations.assign(
+                        perturbations.begin() + perturbation_id,
+                        perturbations.begin() + perturbation_id + batch_size);
+                batch->run(solution_cur, solution_cur_id, batch_perturbations);
+                for (Counter j = 0; j < batch_size; ++j) {
+                    check_solution(
+                            batch->solution(j),
+                            perturbation_id + j,
+                            output.number_of_iterations + j);
+                }
+                perturbation_id += batch_size;
+                output.number_of_iterations += batch_size - 1;
+                continue;
+            }
+
+            // Apply perturbation and local search, either on a copy of the
+            // current solution or, if the local scheme supports it, on the
+            // current solution itself which is rolled back afterwards.
+            Solution& solution_tmp = start_perturbation(local_scheme, solution_cur, solution_copy);
             auto perturbation = perturbations[perturbation_id];
             local_scheme.apply_perturbation(solution_tmp, perturbation, generator);
             local_scheme.local_search(solution_tmp, generator, perturbation);
-
-            // Check for a new best solution.
-            if (output.solution_pool.size() == 0
-                || strictly_better(
-                    local_scheme,
-                    local_scheme.global_cost(solution_tmp),
-                    local_scheme.global_cost(output.solution_pool.worst()))) {
-                std::stringstream ss;
-                ss << "s" << output.number_of_restarts
-                    << " d" << depth
-                    << " c" << perturbation_id << "/" << perturbations.size()
-                    << " i" << output.number_of_iterations;
-                algorithm_formatter.update_solution(solution_tmp, ss);
-            }
-
-            if (local_scheme.global_cost(solution_next)
-                    > local_scheme.global_cost(solution_tmp)) {
-                solution_next = solution_tmp;
-                better_found = true;
-            }
+            check_solution(solution_tmp, perturbation_id, output.number_of_iterations);
+            end_perturbation(local_scheme, solution_tmp);
 
             perturbation_id++;
         }
@@ -118,7 +118,7 @@ inline const MultiStartLocalSearchOutput<LocalScheme> multi_start_local_search(
                 && !strictly_better(
                     local_scheme,
                     parameters.goal,
-                    local_scheme.global_cost(output.solution_pool.best())))
+                    output.solution_pool.best_global_cost()))
             break;
 
         // Generate initial solution.
@@ -134,7 +134,7 @@ inline const MultiStartLocalSearchOutput<LocalScheme> multi_start_local_search(
                 || strictly_better(
                     local_scheme,
                     local_scheme.global_cost(solution),
-                    local_scheme.global_cost(output.solution_pool.worst()))) {
+                    output.solution_pool.worst_global_cost())) {
             std::stringstream ss;
             ss << "iteration " << output.number_of_restarts;
             algorithm_formatter.update_solution(solution, ss);
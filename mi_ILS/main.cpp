@@ -3,20 +3,37 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <cstdint>
 #include "localsearchsolver/iterated_local_search.hpp"
 #include "InstanciaMIS.hpp"
 #include "EsquemaMIS.hpp"
+#include "ReduccionesMIS.hpp"
+#include "ComponentesMIS.hpp"
+#include "LoteMIS.hpp"
+#include <fstream>
+#include <memory>
 
 using namespace localsearchsolver;
-using my_scheme = EsquemaMIS;
 
 void mostrar_uso(const std::string& prog_name) {
     std::cerr << "Uso: " << prog_name << " -i <archivo.graph> -t <tiempo_segundos> [opciones]\n"
+              << "     " << prog_name << " --lote <manifiesto> [--salida <archivo.csv|.json>] [opciones]\n"
               << "Opciones:\n"
               << "  --alpha <valor>  Aleatoriedad para GRASP (0.0 a 1.0, def: 0.3)\n"
-              << "  --fuerza <n>   Fuerza de la perturbacion (nodos a quitar, def: 2)\n"
+              << "  --fuerza <n>   Fuerza de la perturbacion (nodos a forzar, def: 2)\n"
               << "  --iter <n>     Numero maximo de iteraciones (def: sin limite)\n"
-              << "  --pert <n>     Numero minimo de perturbaciones por ciclo (def: 1)\n";
+              << "  --pert <n>     Numero minimo de perturbaciones por ciclo (def: 1)\n"
+              << "  --algorithm <nombre>  iterated-local-search (def), best-first-local-search\n"
+              << "                 o genetic-local-search\n"
+              << "  --threads <n>  Hilos a usar (componentes en paralelo e islas, def: 1;\n"
+              << "                 0 = todos los nucleos)\n"
+              << "  --seed <n>     Semilla (def: aleatoria); con --threads 1 la corrida es reproducible\n"
+              << "  --sin-cache    No leer ni escribir el cache binario <archivo>.csr\n"
+              << "  --sin-reducciones  Buscar sobre el grafo completo, sin kernelizar\n"
+              << "  --lote <archivo>   Correr los experimentos del manifiesto (ver LoteMIS.hpp);\n"
+              << "                     usa --algorithm, --iter, --threads, --sin-cache y\n"
+              << "                     --sin-reducciones, el resto viene del manifiesto\n"
+              << "  --salida <archivo> Tabla de resultados del lote (def: CSV por stdout)\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -26,9 +43,23 @@ int main(int argc, char* argv[]) {
     int fuerza_param = 2;
     Counter max_iterations = -1;
     Counter min_perturbations = 1;
+    // Un solo hilo por defecto: las islas en paralelo no son deterministas.
+    unsigned threads = 1;
+    bool semilla_fija = false;
+    std::uint64_t semilla = 0;
+    std::string algorithm = "iterated-local-search";
+    bool usar_cache = true;
+    bool usar_reducciones = true;
+    std::string manifiesto = "";
+    std::string salida = "";
+    // Opciones que en modo lote vienen del manifiesto.
+    std::vector<std::string> opciones_de_manifiesto;
 
     std::vector<std::string> args(argv + 1, argv + argc);
     for (size_t i = 0; i < args.size(); ++i) {
+        if ((args[i] == "-i" || args[i] == "-t" || args[i] == "--alpha" || args[i] == "--fuerza"
+                || args[i] == "--pert" || args[i] == "--seed") && i + 1 < args.size())
+            opciones_de_manifiesto.push_back(args[i]);
         if (args[i] == "-i" && i + 1 < args.size()) {
             filename = args[++i];
         } else if (args[i] == "-t" && i + 1 < args.size()) {
@@ -41,38 +72,115 @@ int main(int argc, char* argv[]) {
             max_iterations = std::stoll(args[++i]);
         } else if (args[i] == "--pert" && i + 1 < args.size()) {
             min_perturbations = std::stoll(args[++i]);
+        } else if (args[i] == "--algorithm" && i + 1 < args.size()) {
+            algorithm = args[++i];
+        } else if (args[i] == "--threads" && i + 1 < args.size()) {
+            int t = std::stoi(args[++i]);
+            threads = (t <= 0) ? numero_de_hilos() : (unsigned)t;
+        } else if (args[i] == "--seed" && i + 1 < args.size()) {
+            semilla = std::stoull(args[++i]);
+            semilla_fija = true;
+        } else if (args[i] == "--sin-cache") {
+            usar_cache = false;
+        } else if (args[i] == "--sin-reducciones") {
+            usar_reducciones = false;
+        } else if (args[i] == "--lote" && i + 1 < args.size()) {
+            manifiesto = args[++i];
+        } else if (args[i] == "--salida" && i + 1 < args.size()) {
+            salida = args[++i];
         }
     }
 
+    if (!manifiesto.empty()) {
+        if (!opciones_de_manifiesto.empty()) {
+            std::cerr << "Con --lote, " << opciones_de_manifiesto.front()
+                      << " se define en el manifiesto." << std::endl;
+            mostrar_uso(argv[0]);
+            return 1;
+        }
+        ParametrosComponentes base;
+        try {
+            base.algoritmo = leer_algoritmo(algorithm);
+        } catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << std::endl;
+            mostrar_uso(argv[0]);
+            return 1;
+        }
+        base.max_iteraciones = max_iterations;
+        std::vector<TrabajoLote> trabajos = leer_manifiesto(manifiesto);
+        ejecutar_lote(trabajos, threads, usar_cache, usar_reducciones, base);
+        bool json = salida.size() >= 5 && salida.compare(salida.size() - 5, 5, ".json") == 0;
+        if (salida.empty()) {
+            escribir_resultados_lote(trabajos, std::cout, json);
+        } else {
+            std::ofstream file(salida);
+            if (!file.is_open()) {
+                std::cerr << "No se pudo escribir: " << salida << std::endl;
+                return 1;
+            }
+            escribir_resultados_lote(trabajos, file, json);
+        }
+        return 0;
+    }
+
     if (filename.empty() || time_limit <= 0) {
         mostrar_uso(argv[0]);
         return 1;
     }
+
+    AlgoritmoMIS algoritmo;
+    try {
+        algoritmo = leer_algoritmo(algorithm);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        mostrar_uso(argv[0]);
+        return 1;
+    }
     
     auto total_time_start = std::chrono::high_resolution_clock::now();
     
-    Graph graph(filename);
-    my_scheme esquema(graph);
-    esquema.alpha = alpha_param;
-    esquema.fuerza_perturbacion = fuerza_param;
+    Graph graph(filename, usar_cache);
+
+    // Kernelizacion: el ILS trabaja sobre el grafo reducido y la solucion se
+    // levanta al grafo original al final. Los diagnosticos van a stderr
+    // para no mezclarse con FINAL_STATS.
+    std::unique_ptr<ReduccionesMIS> reducciones;
+    const Graph* grafo_busqueda = &graph;
+    if (usar_reducciones) {
+        reducciones.reset(new ReduccionesMIS(graph));
+        grafo_busqueda = &reducciones->kernel();
+        std::cerr << "Kernel: " << graph.n() << " -> " << grafo_busqueda->n() << " vertices, "
+                  << graph.m() << " -> " << grafo_busqueda->m() << " aristas, "
+                  << reducciones->tamanio_fijo() << " vertices fijos" << std::endl;
+    }
 
-    IteratedLocalSearchParameters<my_scheme> params;
-    params.timer.set_time_limit(time_limit);
-    params.maximum_number_of_iterations = max_iterations;
-    params.minimum_number_of_perturbations = min_perturbations;
-    params.seed = std::random_device{}();
+    // Cada componente conexa se resuelve por separado: las chicas de forma
+    // exacta y las grandes con un ILS por componente, en paralelo.
+    ParametrosComponentes params;
+    params.tiempo_limite = time_limit;
+    params.max_iteraciones = max_iterations;
+    params.min_perturbaciones = min_perturbations;
+    params.alpha = alpha_param;
+    params.fuerza_perturbacion = fuerza_param;
+    params.algoritmo = algoritmo;
+    params.hilos = threads;
+    params.semilla = semilla_fija ? semilla : std::random_device{}();
     params.verbosity_level = 1; // Salida silenciosa para un parseo limpio
 
-    iterated_local_search(esquema, params);
+    ResultadoComponentes resultado = resolver_por_componentes(*grafo_busqueda, params);
+    std::cerr << "Componentes: " << resultado.componentes << " ("
+              << resultado.componentes_exactas << " resueltas de forma exacta, "
+              << resultado.componentes_con_piso << " con el tiempo minimo)" << std::endl;
+    int tamanio = reducciones ? reducciones->levantar(resultado.solucion).size : resultado.solucion.size;
 
     auto total_time_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> total_elapsed = total_time_end - total_time_start;
 
-    if (esquema.get_best_solution_size() > 0) {
+    if (tamanio > 0) {
         std::cout << "FINAL_STATS: "
-                  << esquema.get_best_solution_size() << ","
+                  << tamanio << ","
                   << total_elapsed.count() << ","
-                  << esquema.get_time_to_best()
+                  << resultado.tiempo_al_mejor
                   << std::endl;
     } else {
         std::cout << "FINAL_STATS: 0,0,0" << std::endl;
@@ -0,0 +1,126 @@
+// Prueba de ReduccionesMIS: en grafos aleatorios chicos, kernelizar, resolver
+// el kernel de forma exacta y levantar la solucion debe dar un conjunto
+// independiente del grafo original de tamanio alpha(G), calculado con
+// MISExacto sobre el grafo completo.
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "ReduccionesMIS.hpp"
+#include "ComponentesMIS.hpp"
+
+namespace {
+
+using Aristas = std::vector<std::pair<int, int>>;
+
+// G(n, p).
+Aristas aleatorio(int n, double p, std::mt19937_64& generator) {
+    std::bernoulli_distribution moneda(p);
+    Aristas aristas;
+    for (int u = 0; u < n; ++u)
+        for (int v = u + 1; v < n; ++v)
+            if (moneda(generator)) aristas.push_back({u, v});
+    return aristas;
+}
+
+// Grafo de grado maximo chico: union de ciclos y caminos mas algunas cuerdas,
+// para que aparezcan pliegues de grado 2 y gemelos de grado 3.
+Aristas grado_bajo(int n, std::mt19937_64& generator) {
+    std::vector<int> orden(n);
+    for (int v = 0; v < n; ++v) orden[v] = v;
+    std::shuffle(orden.begin(), orden.end(), generator);
+    Aristas aristas;
+    std::uniform_int_distribution<int> largo(2, 8);
+    for (int i = 0; i < n;) {
+        int l = std::min(largo(generator), n - i);
+        for (int j = 1; j < l; ++j) aristas.push_back({orden[i + j - 1], orden[i + j]});
+        if (l >= 3 && generator() % 2 == 0) aristas.push_back({orden[i], orden[i + l - 1]});
+        i += l;
+    }
+    std::uniform_int_distribution<int> vertice(0, n - 1);
+    int cuerdas = n / 4;
+    for (int c = 0; c < cuerdas; ++c) {
+        int u = vertice(generator), v = vertice(generator);
+        if (u != v) aristas.push_back({std::min(u, v), std::max(u, v)});
+    }
+    std::sort(aristas.begin(), aristas.end());
+    aristas.erase(std::unique(aristas.begin(), aristas.end()), aristas.end());
+    return aristas;
+}
+
+// Gemelos: k pares (u, v) con N(u) = N(v) de tamanio 3, con o sin aristas
+// dentro de la vecindad, unidos por algunas aristas al azar.
+Aristas gemelos(int k, std::mt19937_64& generator) {
+    Aristas aristas;
+    for (int i = 0; i < k; ++i) {
+        int b = 5 * i;
+        for (int x = 2; x < 5; ++x) {
+            aristas.push_back({b, b + x});
+            aristas.push_back({b + 1, b + x});
+        }
+        if (generator() % 2 == 0) aristas.push_back({b + 2, b + 3});
+        if (i > 0 && generator() % 2 == 0) aristas.push_back({b - 1, b + 4});
+    }
+    return aristas;
+}
+
+bool probar(int n, const Aristas& aristas, const char* familia, int caso) {
+    Graph g(n, aristas);
+    int alpha = __builtin_popcountll(MISExacto(g).resolver());
+
+    ReduccionesMIS reducciones(g);
+    const Graph& kernel = reducciones.kernel();
+    std::uint64_t mascara = (kernel.n() > 0) ? MISExacto(kernel).resolver() : 0;
+
+    InstanciaMIS instancia_kernel(kernel);
+    InstanciaMIS::Solucion s_kernel;
+    s_kernel.inicializar(kernel.n());
+    for (int v = 0; v < kernel.n(); ++v)
+        if ((mascara >> v) & 1) instancia_kernel.agregar(s_kernel, v);
+
+    InstanciaMIS::Solucion s;
+    try {
+        s = reducciones.levantar(s_kernel);
+    } catch (const std::exception& e) {
+        std::printf("%s %d (n = %d): %s\n", familia, caso, n, e.what());
+        return false;
+    }
+    InstanciaMIS instancia(g);
+    if (!instancia.es_valida(s)) {
+        std::printf("%s %d (n = %d): la solucion levantada no es independiente.\n", familia, caso, n);
+        return false;
+    }
+    if (s.size != alpha || reducciones.tamanio_fijo() + __builtin_popcountll(mascara) != alpha) {
+        std::printf("%s %d (n = %d): tamanio %d, fijo %d + kernel %d, optimo %d.\n",
+                    familia, caso, n, s.size, reducciones.tamanio_fijo(),
+                    __builtin_popcountll(mascara), alpha);
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main() {
+    std::mt19937_64 generator(0);
+    int fallas = 0, casos = 0;
+    for (int caso = 0; caso < 2000; ++caso) {
+        int n = 1 + (int)(generator() % 40);
+        double p = std::uniform_real_distribution<double>(0.02, 0.4)(generator);
+        fallas += !probar(n, aleatorio(n, p, generator), "aleatorio", caso);
+        casos++;
+    }
+    for (int caso = 0; caso < 2000; ++caso) {
+        int n = 1 + (int)(generator() % 60);
+        fallas += !probar(n, grado_bajo(n, generator), "grado_bajo", caso);
+        casos++;
+    }
+    for (int caso = 0; caso < 500; ++caso) {
+        int k = 1 + (int)(generator() % 12);
+        fallas += !probar(5 * k, gemelos(k, generator), "gemelos", caso);
+        casos++;
+    }
+    std::printf("%d casos, %d fallas.\n", casos, fallas);
+    return (fallas == 0) ? 0 : 1;
+}